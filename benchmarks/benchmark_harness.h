@@ -0,0 +1,461 @@
+/**
+ * @file benchmark_harness.h
+ * @brief Minimal Google-Benchmark-style harness without external dependencies
+ *
+ * Benchmarks are plain functions taking a bench::State&. The timed region is
+ * the body of the `while (state.keep_running())` loop; everything before the
+ * loop (dataset generation, index build, query box generation) is setup and
+ * is not measured. The runner grows the iteration count until a benchmark
+ * runs for at least --min_time seconds, then reports per-iteration time and
+ * the rates derived from the items/bytes counters set by the benchmark.
+ * With --repetitions=N each benchmark is re-run N times at the same
+ * iteration count and the median and MAD of ns/iter are reported; results
+ * can be written to JSON and compared against a stored baseline (see
+ * benchmark_report.h).
+ *
+ * Example:
+ * @code
+ * static void BM_Query(bench::State& state) {
+ *     auto boxes = make_boxes(state.range(0));   // setup, not timed
+ *     size_t k = 0;
+ *     while (state.keep_running()) {
+ *         bench::do_not_optimize(grid.query_box(...boxes[k++ & mask]...));
+ *     }
+ *     state.set_items_processed(points_returned);
+ * }
+ * BENCHMARK(BM_Query)->args({1000})->args({100000});
+ * @endcode
+ */
+
+#ifndef GRID_INDEX_BENCHMARK_HARNESS_H
+#define GRID_INDEX_BENCHMARK_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "benchmark_report.h"
+
+namespace bench {
+
+/**
+ * @brief Prevent the compiler from optimizing away a computed value
+ */
+template<typename V>
+inline void do_not_optimize(const V& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * @brief Force pending memory writes to be considered observable
+ */
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+/**
+ * @brief Per-run state handed to a benchmark function
+ */
+class State {
+public:
+    State(const std::vector<int64_t>& args, int64_t max_iterations)
+        : args_(args), max_iterations_(max_iterations), iterations_(0),
+          started_(false), paused_ns_(0),
+          items_processed_(0), bytes_processed_(0) {}
+
+    /**
+     * @brief Loop condition of the timed region
+     * @return true while more iterations are to be run
+     */
+    bool keep_running() {
+        if (!started_) {
+            started_ = true;
+            start_ = Clock::now();
+        }
+        if (iterations_ < max_iterations_) {
+            ++iterations_;
+            return true;
+        }
+        stop_ = Clock::now();
+        return false;
+    }
+
+    /**
+     * @brief Exclude the following code from the measured time
+     */
+    void pause_timing() {
+        pause_start_ = Clock::now();
+    }
+
+    /**
+     * @brief Resume timing after pause_timing()
+     */
+    void resume_timing() {
+        paused_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - pause_start_).count();
+    }
+
+    /** @brief Benchmark argument i as registered with args() */
+    int64_t range(size_t i) const { return args_.at(i); }
+
+    /** @brief Number of iterations of the timed loop */
+    int64_t iterations() const { return max_iterations_; }
+
+    /** @brief Total items (points, queries...) processed over all iterations */
+    void set_items_processed(int64_t items) { items_processed_ = items; }
+
+    /** @brief Total bytes touched over all iterations */
+    void set_bytes_processed(int64_t bytes) { bytes_processed_ = bytes; }
+
+    /** @brief Free-form text appended to the report line */
+    void set_label(const std::string& label) { label_ = label; }
+
+    /** @brief Record an error; the benchmark is reported as failed */
+    void skip_with_error(const std::string& message) {
+        error_ = message;
+        max_iterations_ = 0;
+    }
+
+    // Accessors used by the runner
+    double elapsed_ns() const {
+        if (!started_) return 0.0;
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            stop_ - start_).count() - paused_ns_);
+    }
+    int64_t items_processed() const { return items_processed_; }
+    int64_t bytes_processed() const { return bytes_processed_; }
+    const std::string& label() const { return label_; }
+    const std::string& error() const { return error_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<int64_t> args_;
+    int64_t max_iterations_;
+    int64_t iterations_;
+    bool started_;
+    Clock::time_point start_, stop_, pause_start_;
+    int64_t paused_ns_;
+    int64_t items_processed_;
+    int64_t bytes_processed_;
+    std::string label_;
+    std::string error_;
+};
+
+typedef void (*Function)(State&);
+
+/**
+ * @brief A registered benchmark with its list of argument tuples
+ */
+class Benchmark {
+public:
+    Benchmark(const std::string& name, Function fn) : name_(name), fn_(fn) {}
+
+    /** @brief Add one argument tuple */
+    Benchmark* args(const std::vector<int64_t>& a) {
+        args_.push_back(a);
+        return this;
+    }
+
+    /** @brief Add the cartesian product of the given argument lists */
+    Benchmark* args_product(const std::vector<std::vector<int64_t>>& lists) {
+        std::vector<int64_t> current;
+        add_product(lists, 0, current);
+        return this;
+    }
+
+    /** @brief Names printed for each argument position ("n", "box", ...) */
+    Benchmark* arg_names(const std::vector<std::string>& names) {
+        arg_names_ = names;
+        return this;
+    }
+
+    const std::string& name() const { return name_; }
+    Function function() const { return fn_; }
+    const std::vector<std::vector<int64_t>>& arg_sets() const { return args_; }
+
+    /** @brief Full run name, e.g. "BM_Query/n:1000/box:4" */
+    std::string run_name(const std::vector<int64_t>& a) const {
+        std::string s = name_;
+        for (size_t i = 0; i < a.size(); ++i) {
+            s += "/";
+            if (i < arg_names_.size() && !arg_names_[i].empty()) {
+                s += arg_names_[i] + ":";
+            }
+            s += std::to_string(static_cast<long long>(a[i]));
+        }
+        return s;
+    }
+
+private:
+    std::string name_;
+    Function fn_;
+    std::vector<std::vector<int64_t>> args_;
+    std::vector<std::string> arg_names_;
+
+    void add_product(const std::vector<std::vector<int64_t>>& lists, size_t pos,
+                     std::vector<int64_t>& current) {
+        if (pos == lists.size()) {
+            args_.push_back(current);
+            return;
+        }
+        for (size_t i = 0; i < lists[pos].size(); ++i) {
+            current.push_back(lists[pos][i]);
+            add_product(lists, pos + 1, current);
+            current.pop_back();
+        }
+    }
+};
+
+/**
+ * @brief Global list of registered benchmarks
+ */
+inline std::vector<Benchmark*>& registry() {
+    static std::vector<Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+inline Benchmark* register_benchmark(const char* name, Function fn) {
+    Benchmark* b = new Benchmark(name, fn);
+    registry().push_back(b);
+    return b;
+}
+
+/**
+ * @brief Result of one run of a benchmark (one argument tuple, one repetition)
+ */
+struct Result {
+    std::string name;
+    int64_t iterations;
+    double ns_per_iter;       // ns/query for query benchmarks
+    double items_per_second;  // points/s
+    double bytes_per_iter;    // bytes/query
+    std::string label;
+    std::string error;
+};
+
+/**
+ * @brief Run a benchmark for a fixed number of iterations
+ */
+inline Result run_iterations(const Benchmark& b, const std::vector<int64_t>& a, int64_t iters) {
+    State state(a, iters);
+    b.function()(state);
+    const double ns = state.elapsed_ns();
+    Result r;
+    r.name = b.run_name(a);
+    r.iterations = state.iterations();
+    r.ns_per_iter = r.iterations > 0 ? ns / r.iterations : 0.0;
+    r.items_per_second = ns > 0 ? state.items_processed() * 1e9 / ns : 0.0;
+    r.bytes_per_iter = r.iterations > 0
+        ? static_cast<double>(state.bytes_processed()) / r.iterations : 0.0;
+    r.label = state.label();
+    r.error = state.error();
+    return r;
+}
+
+/**
+ * @brief Run a benchmark with growing iteration counts until min_time is reached
+ */
+inline Result run_one(const Benchmark& b, const std::vector<int64_t>& a, double min_time) {
+    const double min_ns = min_time * 1e9;
+    int64_t iters = 1;
+    for (;;) {
+        Result r = run_iterations(b, a, iters);
+        const double ns = r.ns_per_iter * static_cast<double>(r.iterations);
+        if (!r.error.empty() || ns >= min_ns || iters >= 1000000000) {
+            return r;
+        }
+        // Predict the iteration count that reaches min_time, with headroom
+        double multiplier = ns > 0 ? (min_ns * 1.4) / ns : 10.0;
+        if (multiplier > 10.0) multiplier = 10.0;
+        if (multiplier < 2.0) multiplier = 2.0;
+        iters = static_cast<int64_t>(iters * multiplier) + 1;
+    }
+}
+
+/**
+ * @brief Run a benchmark `repetitions` times and summarize with median and MAD
+ *
+ * The first repetition calibrates the iteration count; later repetitions
+ * reuse it so that all samples measure the same amount of work.
+ */
+inline Summary run_repeated(const Benchmark& b, const std::vector<int64_t>& a,
+                            double min_time, int repetitions) {
+    std::vector<Result> runs;
+    runs.push_back(run_one(b, a, min_time));
+    for (int k = 1; k < repetitions && runs[0].error.empty(); ++k) {
+        runs.push_back(run_iterations(b, a, runs[0].iterations));
+    }
+
+    Summary s;
+    s.name = runs[0].name;
+    s.iterations = runs[0].iterations;
+    s.label = runs[0].label;
+    s.error = runs[0].error;
+    std::vector<double> rates, bytes;
+    for (size_t k = 0; k < runs.size(); ++k) {
+        s.samples_ns.push_back(runs[k].ns_per_iter);
+        rates.push_back(runs[k].items_per_second);
+        bytes.push_back(runs[k].bytes_per_iter);
+    }
+    s.median_ns = median(s.samples_ns);
+    s.mad_ns = mad(s.samples_ns);
+    s.items_per_second = median(rates);
+    s.bytes_per_iter = median(bytes);
+    return s;
+}
+
+inline void print_header() {
+    std::printf("%-64s %14s %10s %12s %14s %14s\n",
+                "Benchmark", "ns/iter", "MAD", "iterations", "points/s", "bytes/iter");
+    std::printf("%s\n", std::string(133, '-').c_str());
+}
+
+inline void print_summary(const Summary& r) {
+    if (!r.error.empty()) {
+        std::printf("%-64s ERROR: %s\n", r.name.c_str(), r.error.c_str());
+        return;
+    }
+    std::printf("%-64s %14.1f %10.1f %12lld %14.4g %14.1f %s\n",
+                r.name.c_str(), r.median_ns, r.mad_ns, static_cast<long long>(r.iterations),
+                r.items_per_second, r.bytes_per_iter, r.label.c_str());
+    std::fflush(stdout);
+}
+
+inline void print_usage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  --filter=SUBSTR      run only benchmarks whose name contains SUBSTR\n"
+                 "  --min_time=SEC       minimum measured time per benchmark (default 0.1)\n"
+                 "  --repetitions=N      repeat each benchmark N times (default 1)\n"
+                 "  --out=FILE           write results as JSON\n"
+                 "  --baseline=FILE      compare against a stored JSON result file;\n"
+                 "                       exit code 1 on significant regressions\n"
+                 "  --compare=FILE       compare FILE against --baseline without running\n"
+                 "  --threshold=FRAC     minimum relative slowdown (default 0.05)\n"
+                 "  --z_threshold=Z      minimum robust z-score (default 3.0)\n"
+                 "  --list               print run names and exit\n",
+                 program);
+}
+
+/**
+ * @brief Command-line entry point (see print_usage() for options)
+ *
+ * Exit codes: 0 success, 1 regressions found, 2 usage or I/O error.
+ */
+inline int run_main(int argc, char** argv) {
+    std::string filter, out_path, baseline_path, compare_path;
+    double min_time = 0.1;
+    int repetitions = 1;
+    bool list_only = false;
+    CompareOptions compare_options;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--filter=", 9) == 0) {
+            filter = arg + 9;
+        } else if (std::strncmp(arg, "--min_time=", 11) == 0) {
+            min_time = std::atof(arg + 11);
+        } else if (std::strncmp(arg, "--repetitions=", 14) == 0) {
+            repetitions = std::max(1, std::atoi(arg + 14));
+        } else if (std::strncmp(arg, "--out=", 6) == 0) {
+            out_path = arg + 6;
+        } else if (std::strncmp(arg, "--baseline=", 11) == 0) {
+            baseline_path = arg + 11;
+        } else if (std::strncmp(arg, "--compare=", 10) == 0) {
+            compare_path = arg + 10;
+        } else if (std::strncmp(arg, "--threshold=", 12) == 0) {
+            compare_options.threshold = std::atof(arg + 12);
+        } else if (std::strncmp(arg, "--z_threshold=", 14) == 0) {
+            compare_options.z_threshold = std::atof(arg + 14);
+        } else if (std::strcmp(arg, "--list") == 0) {
+            list_only = true;
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg);
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Summary> results;
+    if (!compare_path.empty()) {
+        if (baseline_path.empty()) {
+            std::fprintf(stderr, "--compare requires --baseline\n");
+            return 2;
+        }
+        if (!read_json(compare_path, results)) {
+            std::fprintf(stderr, "Cannot read results from %s\n", compare_path.c_str());
+            return 2;
+        }
+    } else {
+        if (!list_only) print_header();
+        for (size_t bi = 0; bi < registry().size(); ++bi) {
+            const Benchmark& b = *registry()[bi];
+            std::vector<std::vector<int64_t>> sets = b.arg_sets();
+            if (sets.empty()) sets.push_back(std::vector<int64_t>());
+            for (size_t ai = 0; ai < sets.size(); ++ai) {
+                std::string name = b.run_name(sets[ai]);
+                if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+                if (list_only) {
+                    std::printf("%s\n", name.c_str());
+                    continue;
+                }
+                results.push_back(run_repeated(b, sets[ai], min_time, repetitions));
+                print_summary(results.back());
+            }
+        }
+        if (list_only) return 0;
+    }
+
+    if (!out_path.empty() && !write_json(out_path, results, repetitions, min_time)) {
+        std::fprintf(stderr, "Cannot write results to %s\n", out_path.c_str());
+        return 2;
+    }
+
+    if (!baseline_path.empty()) {
+        std::vector<Summary> baseline;
+        if (!read_json(baseline_path, baseline)) {
+            std::fprintf(stderr, "Cannot read baseline from %s\n", baseline_path.c_str());
+            return 2;
+        }
+        if (compare_to_baseline(results, baseline, compare_options) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+} // namespace bench
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Register a benchmark function; returns Benchmark* for chaining
+ */
+#define BENCHMARK(fn) \
+    static bench::Benchmark* BENCH_CONCAT(bench_registration_, __LINE__) = \
+        bench::register_benchmark(#fn, fn)
+
+/**
+ * @brief Register a named benchmark (e.g. a template instantiation)
+ */
+#define BENCHMARK_NAMED(name, fn) \
+    static bench::Benchmark* BENCH_CONCAT(bench_registration_, __LINE__) = \
+        bench::register_benchmark(name, fn)
+
+#define BENCHMARK_MAIN() \
+    int main(int argc, char** argv) { return bench::run_main(argc, argv); }
+
+#endif // GRID_INDEX_BENCHMARK_HARNESS_H
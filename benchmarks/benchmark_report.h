@@ -0,0 +1,352 @@
+/**
+ * @file benchmark_report.h
+ * @brief JSON result files and baseline comparison for the benchmark harness
+ *
+ * A result file records, per benchmark run name, the per-repetition ns/iter
+ * samples together with their median and MAD (median absolute deviation).
+ * compare_to_baseline() flags a benchmark as regressed when its median got
+ * slower by more than a relative threshold AND the change is statistically
+ * significant under a robust z-score:
+ *
+ *     z = (median_new - median_base) / (1.4826 * sqrt(MAD_new^2 + MAD_base^2))
+ *
+ * 1.4826 * MAD estimates the standard deviation of normally distributed
+ * samples while being insensitive to the occasional outlier repetition
+ * (page faults, frequency changes, other processes).
+ */
+
+#ifndef GRID_INDEX_BENCHMARK_REPORT_H
+#define GRID_INDEX_BENCHMARK_REPORT_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @brief Aggregated result of all repetitions of one benchmark run
+ */
+struct Summary {
+    std::string name;
+    int64_t iterations;
+    std::vector<double> samples_ns;  // ns/iter of each repetition
+    double median_ns;
+    double mad_ns;
+    double items_per_second;  // Median over repetitions
+    double bytes_per_iter;
+    std::string label;
+    std::string error;
+};
+
+inline double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+/** @brief Median absolute deviation from the median */
+inline double mad(const std::vector<double>& v) {
+    const double m = median(v);
+    std::vector<double> dev;
+    dev.reserve(v.size());
+    for (size_t i = 0; i < v.size(); ++i) {
+        dev.push_back(std::fabs(v[i] - m));
+    }
+    return median(dev);
+}
+
+inline std::string json_escape(const std::string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const char c = s[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Write summaries as JSON
+ * @return false if the file could not be written
+ */
+inline bool write_json(const std::string& path, const std::vector<Summary>& results,
+                       int repetitions, double min_time) {
+    std::ofstream out(path.c_str());
+    if (!out) return false;
+    out.precision(17);
+    out << "{\n  \"context\": {\"repetitions\": " << repetitions
+        << ", \"min_time\": " << min_time << "},\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Summary& r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << json_escape(r.name) << "\""
+            << ", \"iterations\": " << r.iterations
+            << ", \"median_ns\": " << r.median_ns
+            << ", \"mad_ns\": " << r.mad_ns
+            << ", \"items_per_second\": " << r.items_per_second
+            << ", \"bytes_per_iter\": " << r.bytes_per_iter
+            << ", \"label\": \"" << json_escape(r.label) << "\""
+            << ", \"error\": \"" << json_escape(r.error) << "\""
+            << ", \"samples_ns\": [";
+        for (size_t k = 0; k < r.samples_ns.size(); ++k) {
+            out << (k ? ", " : "") << r.samples_ns[k];
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief Minimal JSON reader for result files written by write_json()
+ *
+ * Supports objects, arrays, strings, numbers, true/false/null. Unknown keys
+ * are skipped, so files from newer harness versions still load.
+ */
+class JsonReader {
+public:
+    explicit JsonReader(const std::string& text) : s_(text), pos_(0) {}
+
+    bool read_results(std::vector<Summary>& results) {
+        if (!expect('{')) return false;
+        if (peek('}')) return ++pos_, true;
+        do {
+            std::string key;
+            if (!read_string(key) || !expect(':')) return false;
+            if (key == "benchmarks") {
+                if (!read_benchmarks(results)) return false;
+            } else if (!skip_value()) {
+                return false;
+            }
+        } while (consume(','));
+        return expect('}');
+    }
+
+private:
+    const std::string& s_;
+    size_t pos_;
+
+    void skip_ws() {
+        while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_]))) ++pos_;
+    }
+    bool peek(char c) {
+        skip_ws();
+        return pos_ < s_.size() && s_[pos_] == c;
+    }
+    bool consume(char c) {
+        if (peek(c)) { ++pos_; return true; }
+        return false;
+    }
+    bool expect(char c) { return consume(c); }
+
+    bool read_string(std::string& out) {
+        if (!expect('"')) return false;
+        out.clear();
+        while (pos_ < s_.size() && s_[pos_] != '"') {
+            char c = s_[pos_++];
+            if (c == '\\' && pos_ < s_.size()) {
+                char e = s_[pos_++];
+                if (e == 'u' && pos_ + 4 <= s_.size()) {
+                    out += static_cast<char>(std::strtol(s_.substr(pos_, 4).c_str(), 0, 16));
+                    pos_ += 4;
+                } else {
+                    out += (e == 'n') ? '\n' : (e == 't') ? '\t' : e;
+                }
+            } else {
+                out += c;
+            }
+        }
+        return expect('"');
+    }
+
+    bool read_number(double& out) {
+        skip_ws();
+        const char* begin = s_.c_str() + pos_;
+        char* end = 0;
+        out = std::strtod(begin, &end);
+        if (end == begin) return false;
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    bool skip_value() {
+        skip_ws();
+        if (pos_ >= s_.size()) return false;
+        const char c = s_[pos_];
+        if (c == '"') {
+            std::string tmp;
+            return read_string(tmp);
+        }
+        if (c == '{' || c == '[') {
+            const char close = (c == '{') ? '}' : ']';
+            ++pos_;
+            if (consume(close)) return true;
+            do {
+                if (c == '{') {
+                    std::string key;
+                    if (!read_string(key) || !expect(':')) return false;
+                }
+                if (!skip_value()) return false;
+            } while (consume(','));
+            return expect(close);
+        }
+        if (s_.compare(pos_, 4, "true") == 0 || s_.compare(pos_, 4, "null") == 0) {
+            pos_ += 4;
+            return true;
+        }
+        if (s_.compare(pos_, 5, "false") == 0) {
+            pos_ += 5;
+            return true;
+        }
+        double tmp;
+        return read_number(tmp);
+    }
+
+    bool read_benchmarks(std::vector<Summary>& results) {
+        if (!expect('[')) return false;
+        if (consume(']')) return true;
+        do {
+            Summary r = Summary();
+            if (!expect('{')) return false;
+            if (!peek('}')) {
+                do {
+                    std::string key;
+                    if (!read_string(key) || !expect(':')) return false;
+                    double num = 0.0;
+                    bool ok = true;
+                    if (key == "name") ok = read_string(r.name);
+                    else if (key == "label") ok = read_string(r.label);
+                    else if (key == "error") ok = read_string(r.error);
+                    else if (key == "iterations") { ok = read_number(num); r.iterations = static_cast<int64_t>(num); }
+                    else if (key == "median_ns") ok = read_number(r.median_ns);
+                    else if (key == "mad_ns") ok = read_number(r.mad_ns);
+                    else if (key == "items_per_second") ok = read_number(r.items_per_second);
+                    else if (key == "bytes_per_iter") ok = read_number(r.bytes_per_iter);
+                    else if (key == "samples_ns") {
+                        ok = expect('[');
+                        if (ok && !consume(']')) {
+                            do {
+                                ok = read_number(num);
+                                r.samples_ns.push_back(num);
+                            } while (ok && consume(','));
+                            ok = ok && expect(']');
+                        }
+                    }
+                    else ok = skip_value();
+                    if (!ok) return false;
+                } while (consume(','));
+            }
+            if (!expect('}')) return false;
+            results.push_back(r);
+        } while (consume(','));
+        return expect(']');
+    }
+};
+
+/**
+ * @brief Load a result file written by write_json()
+ * @return false if the file is missing or malformed
+ */
+inline bool read_json(const std::string& path, std::vector<Summary>& results) {
+    std::ifstream in(path.c_str());
+    if (!in) return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+    JsonReader reader(text);
+    return reader.read_results(results);
+}
+
+/**
+ * @brief Regression criteria for compare_to_baseline()
+ */
+struct CompareOptions {
+    double threshold;    // Minimum relative slowdown of the median, e.g. 0.05 = 5%
+    double z_threshold;  // Minimum robust z-score for the change to count as significant
+
+    CompareOptions() : threshold(0.05), z_threshold(3.0) {}
+};
+
+/**
+ * @brief Print a comparison table and count significant regressions
+ *
+ * Benchmarks present on only one side are listed but never count as
+ * regressions, so adding or retiring benchmarks does not break the gate.
+ *
+ * @return Number of regressed benchmarks
+ */
+inline int compare_to_baseline(const std::vector<Summary>& current,
+                               const std::vector<Summary>& baseline,
+                               const CompareOptions& options) {
+    std::map<std::string, const Summary*> base;
+    for (size_t i = 0; i < baseline.size(); ++i) {
+        base[baseline[i].name] = &baseline[i];
+    }
+
+    int regressions = 0;
+    std::printf("\n%-64s %12s %12s %9s %8s  %s\n",
+                "Comparison vs baseline", "base ns", "new ns", "change", "z", "verdict");
+    std::printf("%s\n", std::string(122, '-').c_str());
+    for (size_t i = 0; i < current.size(); ++i) {
+        const Summary& now = current[i];
+        std::map<std::string, const Summary*>::const_iterator it = base.find(now.name);
+        if (it == base.end()) {
+            std::printf("%-64s %12s %12.1f %9s %8s  new\n", now.name.c_str(), "-",
+                        now.median_ns, "-", "-");
+            continue;
+        }
+        const Summary& was = *it->second;
+        base.erase(now.name);
+        if (!now.error.empty() || !was.error.empty() || was.median_ns <= 0.0) {
+            std::printf("%-64s %12s %12s %9s %8s  skipped (error)\n", now.name.c_str(),
+                        "-", "-", "-", "-");
+            continue;
+        }
+
+        const double delta = now.median_ns - was.median_ns;
+        const double change = delta / was.median_ns;
+        const double sigma = 1.4826 * std::sqrt(now.mad_ns * now.mad_ns + was.mad_ns * was.mad_ns);
+        // Zero spread on both sides: any change beyond the threshold is significant
+        const double z = sigma > 0.0 ? delta / sigma : (delta > 0 ? HUGE_VAL : (delta < 0 ? -HUGE_VAL : 0.0));
+
+        const char* verdict = "ok";
+        if (change > options.threshold && z > options.z_threshold) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (change < -options.threshold && z < -options.z_threshold) {
+            verdict = "improved";
+        } else if (std::fabs(change) > options.threshold) {
+            verdict = "noise";
+        }
+        std::printf("%-64s %12.1f %12.1f %+8.1f%% %8.2f  %s\n", now.name.c_str(),
+                    was.median_ns, now.median_ns, 100.0 * change, z, verdict);
+    }
+    for (std::map<std::string, const Summary*>::const_iterator it = base.begin();
+         it != base.end(); ++it) {
+        std::printf("%-64s %12.1f %12s %9s %8s  missing\n", it->first.c_str(),
+                    it->second->median_ns, "-", "-", "-");
+    }
+    std::printf("\n%d regression(s) beyond %.1f%% (z > %.1f)\n", regressions,
+                100.0 * options.threshold, options.z_threshold);
+    return regressions;
+}
+
+} // namespace bench
+
+#endif // GRID_INDEX_BENCHMARK_REPORT_H
@@ -0,0 +1,933 @@
+/**
+ * @file grid_index_benchmarks.cpp
+ * @brief Parameterized benchmarks for GridIndex2D build and query paths
+ *
+ * Arguments of every benchmark:
+ * - n:    number of points
+ * - dist: point distribution (0 uniform, 1 clustered, 2 line acquisition,
+ *         3 skewed, 4 land orthogonal, 5 marine streamer, 6 OBN patches,
+ *         7 crooked 2D lines; 4-7 come from seismic_datasets.h)
+ * - box:  query box side length in grid cells (query benchmarks only)
+ *
+ * Every dataset is indexed with a grid of 100 cells along its longer side
+ * (the 0-3 distributions live on a 1000 x 1000 domain with 10 x 10 cells).
+ * Points, indices and query boxes are generated with fixed seeds before the
+ * timed loop, so numbers are reproducible and do not include RNG cost.
+ *
+ * Reported columns: ns/iter is ns/query (ns/build for build benchmarks),
+ * points/s counts returned (or inserted) points, bytes/iter is the size of
+ * the index data delivered per query.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "benchmark_harness.h"
+#include "../include/seismic_datasets.h"
+#include "../include/grid_index.h"
+
+namespace {
+
+const double DOMAIN_SIZE = 1000.0;
+const double CELLS_PER_SIDE = 100.0;
+const size_t NUM_BOXES = 1024;  // Power of two, cycled through by the query loop
+const size_t NEAREST_K = 16;    // Points per top-k nearest query
+
+enum Distribution {
+    UNIFORM = 0,
+    CLUSTERED = 1,
+    LINE_ACQUISITION = 2,
+    SKEWED = 3,
+    LAND_ORTHOGONAL = 4,
+    MARINE_STREAMER = 5,
+    OBN_PATCHES = 6,
+    CROOKED_2D = 7
+};
+
+enum QueryMode {
+    MODE_VECTOR,
+    MODE_NO_ALLOC,
+    MODE_CALLBACK,
+    MODE_RANGE,
+    MODE_EXISTS,                 // exists_in_box(), row-major
+    MODE_EXISTS_CENTER_OUT,      // exists_in_box(), centre-out
+    MODE_SORTED,                 // query_box_sorted()
+    MODE_NO_ALLOC_THEN_SORT,     // query_box_no_alloc() + std::sort, the baseline for MODE_SORTED
+    MODE_NEAREST,                // query_box_nearest() around the box centre
+    MODE_NO_ALLOC_THEN_NEAREST   // query_box_no_alloc() + std::partial_sort by distance
+};
+
+template<typename T>
+struct Dataset {
+    std::vector<T> x;
+    std::vector<T> y;
+    seismic::Bounds bounds;
+    double cell_size;
+};
+
+template<typename T>
+T clamp_to_domain(double v) {
+    if (v < 0.0) v = 0.0;
+    if (v > DOMAIN_SIZE) v = DOMAIN_SIZE;
+    return static_cast<T>(v);
+}
+
+template<typename T, typename Generator>
+void materialize(const Generator& generator, Dataset<T>& d) {
+    generator.materialize(d.x, d.y);
+    d.bounds = generator.bounds();
+}
+
+/**
+ * @brief Generate n points of the given distribution with a fixed seed
+ */
+template<typename T>
+Dataset<T> generate_points(size_t n, int dist) {
+    Dataset<T> d;
+    d.x.reserve(n);
+    d.y.reserve(n);
+    seismic::Bounds domain = {0.0, DOMAIN_SIZE, 0.0, DOMAIN_SIZE};
+    d.bounds = domain;
+    std::mt19937_64 gen(12345 + dist);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    switch (dist) {
+    case UNIFORM:
+        for (size_t i = 0; i < n; ++i) {
+            d.x.push_back(clamp_to_domain<T>(unit(gen) * DOMAIN_SIZE));
+            d.y.push_back(clamp_to_domain<T>(unit(gen) * DOMAIN_SIZE));
+        }
+        break;
+    case CLUSTERED: {
+        // 64 Gaussian blobs of varying width
+        const int num_clusters = 64;
+        std::vector<double> cx(num_clusters), cy(num_clusters), sigma(num_clusters);
+        for (int c = 0; c < num_clusters; ++c) {
+            cx[c] = unit(gen) * DOMAIN_SIZE;
+            cy[c] = unit(gen) * DOMAIN_SIZE;
+            sigma[c] = 5.0 + unit(gen) * 30.0;
+        }
+        std::normal_distribution<double> normal(0.0, 1.0);
+        std::uniform_int_distribution<int> pick(0, num_clusters - 1);
+        for (size_t i = 0; i < n; ++i) {
+            int c = pick(gen);
+            d.x.push_back(clamp_to_domain<T>(cx[c] + normal(gen) * sigma[c]));
+            d.y.push_back(clamp_to_domain<T>(cy[c] + normal(gen) * sigma[c]));
+        }
+        break;
+    }
+    case LINE_ACQUISITION: {
+        // Dense points along parallel lines 25 units apart, small cross-line jitter
+        const double line_spacing = 25.0;
+        const int num_lines = static_cast<int>(DOMAIN_SIZE / line_spacing);
+        std::uniform_int_distribution<int> pick(0, num_lines - 1);
+        std::normal_distribution<double> jitter(0.0, 0.5);
+        for (size_t i = 0; i < n; ++i) {
+            double line_y = (pick(gen) + 0.5) * line_spacing;
+            d.x.push_back(clamp_to_domain<T>(unit(gen) * DOMAIN_SIZE));
+            d.y.push_back(clamp_to_domain<T>(line_y + jitter(gen)));
+        }
+        break;
+    }
+    case SKEWED:
+        // Density grows strongly towards the origin corner
+        for (size_t i = 0; i < n; ++i) {
+            double u = unit(gen), v = unit(gen);
+            d.x.push_back(clamp_to_domain<T>(u * u * u * DOMAIN_SIZE));
+            d.y.push_back(clamp_to_domain<T>(v * v * DOMAIN_SIZE));
+        }
+        break;
+    case LAND_ORTHOGONAL:
+        materialize(seismic::LandOrthogonalGenerator<T>(n, 42), d);
+        break;
+    case MARINE_STREAMER:
+        materialize(seismic::MarineStreamerGenerator<T>(n, 42), d);
+        break;
+    case OBN_PATCHES:
+        materialize(seismic::ObnPatchGenerator<T>(n, 42), d);
+        break;
+    case CROOKED_2D:
+    default:
+        materialize(seismic::Crooked2DGenerator<T>(n, 42), d);
+        break;
+    }
+    d.cell_size = std::max(d.bounds.x_max - d.bounds.x_min,
+                           d.bounds.y_max - d.bounds.y_min) / CELLS_PER_SIDE;
+    return d;
+}
+
+const char* distribution_name(int dist) {
+    switch (dist) {
+    case UNIFORM: return "uniform";
+    case CLUSTERED: return "clustered";
+    case LINE_ACQUISITION: return "lines";
+    case SKEWED: return "skewed";
+    case LAND_ORTHOGONAL: return "land";
+    case MARINE_STREAMER: return "marine";
+    case OBN_PATCHES: return "obn";
+    default: return "crooked2d";
+    }
+}
+
+/**
+ * @brief Dataset and built index, cached across runs of the same arguments
+ */
+template<typename T>
+struct Fixture {
+    Dataset<T> points;
+    std::unique_ptr<GridIndex2D<T>> grid;
+};
+
+template<typename T>
+GridIndex2D<T>* make_grid(const Dataset<T>& d) {
+    const T step = static_cast<T>(d.cell_size);
+    return new GridIndex2D<T>(static_cast<T>(d.bounds.x_min), static_cast<T>(d.bounds.x_max), step,
+                              static_cast<T>(d.bounds.y_min), static_cast<T>(d.bounds.y_max), step);
+}
+
+template<typename T>
+Fixture<T>& get_fixture(size_t n, int dist) {
+    static std::map<std::pair<size_t, int>, std::unique_ptr<Fixture<T>>> cache;
+    std::unique_ptr<Fixture<T>>& slot = cache[std::make_pair(n, dist)];
+    if (!slot) {
+        slot.reset(new Fixture<T>());
+        slot->points = generate_points<T>(n, dist);
+        slot->grid.reset(make_grid(slot->points));
+        for (size_t i = 0; i < n; ++i) {
+            slot->grid->insert(slot->points.x[i], slot->points.y[i], i);
+        }
+    }
+    return *slot;
+}
+
+/**
+ * @brief Query boxes of side box_cells * cell size centred on data points
+ *
+ * Centring on data points makes query density follow the data, as it does
+ * for gathers around real midpoints.
+ */
+template<typename T>
+std::vector<T> make_boxes(const Dataset<T>& points, int64_t box_cells) {
+    std::vector<T> boxes;
+    boxes.reserve(NUM_BOXES * 4);
+    std::mt19937_64 gen(777);
+    std::uniform_int_distribution<size_t> pick(0, points.x.size() - 1);
+    const double half = 0.5 * static_cast<double>(box_cells) * points.cell_size;
+    for (size_t q = 0; q < NUM_BOXES; ++q) {
+        size_t p = pick(gen);
+        boxes.push_back(static_cast<T>(points.x[p] - half));
+        boxes.push_back(static_cast<T>(points.x[p] + half));
+        boxes.push_back(static_cast<T>(points.y[p] - half));
+        boxes.push_back(static_cast<T>(points.y[p] + half));
+    }
+    return boxes;
+}
+
+/**
+ * @brief Groups of BOXES_PER_UNION overlapping boxes (aperture unions)
+ *
+ * Each group jitters boxes of side box_cells * cell size by up to half a
+ * box around a data point, so neighbouring boxes share most of their cells.
+ */
+const size_t BOXES_PER_UNION = 8;
+
+template<typename T>
+std::vector<std::vector<GridBox<T>>> make_box_groups(const Dataset<T>& points, int64_t box_cells) {
+    std::vector<std::vector<GridBox<T>>> groups(NUM_BOXES);
+    std::mt19937_64 gen(4242);
+    std::uniform_int_distribution<size_t> pick(0, points.x.size() - 1);
+    std::uniform_real_distribution<double> jitter(-0.5, 0.5);
+    const double side = static_cast<double>(box_cells) * points.cell_size;
+    for (size_t q = 0; q < NUM_BOXES; ++q) {
+        const size_t p = pick(gen);
+        for (size_t b = 0; b < BOXES_PER_UNION; ++b) {
+            const double cx = points.x[p] + jitter(gen) * side;
+            const double cy = points.y[p] + jitter(gen) * side;
+            GridBox<T> box = {static_cast<T>(cx - 0.5 * side), static_cast<T>(cx + 0.5 * side),
+                              static_cast<T>(cy - 0.5 * side), static_cast<T>(cy + 0.5 * side)};
+            groups[q].push_back(box);
+        }
+    }
+    return groups;
+}
+
+template<typename T>
+void BM_Build(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    const Dataset<T>& points = get_fixture<T>(n, dist).points;
+
+    while (state.keep_running()) {
+        std::unique_ptr<GridIndex2D<T>> holder(make_grid(points));
+        GridIndex2D<T>& grid = *holder;
+        for (size_t i = 0; i < n; ++i) {
+            grid.insert(points.x[i], points.y[i], i);
+        }
+        bench::do_not_optimize(grid);
+    }
+    state.set_items_processed(state.iterations() * static_cast<int64_t>(n));
+    state.set_bytes_processed(state.iterations() *
+                              static_cast<int64_t>(n * (2 * sizeof(T) + sizeof(size_t))));
+    state.set_label(distribution_name(dist));
+}
+
+/**
+ * @brief Build with insert() into a grid presized from a fold map
+ */
+template<typename T>
+void BM_BuildPresized(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    Fixture<T>& fixture = get_fixture<T>(n, dist);
+    const Dataset<T>& points = fixture.points;
+    const std::vector<size_t> fold = fixture.grid->get_cell_counts();
+    const T step = static_cast<T>(points.cell_size);
+
+    while (state.keep_running()) {
+        GridIndex2D<T> grid(static_cast<T>(points.bounds.x_min), static_cast<T>(points.bounds.x_max), step,
+                            static_cast<T>(points.bounds.y_min), static_cast<T>(points.bounds.y_max), step,
+                            fold);
+        for (size_t i = 0; i < n; ++i) {
+            grid.insert(points.x[i], points.y[i], i);
+        }
+        bench::do_not_optimize(grid);
+    }
+    state.set_items_processed(state.iterations() * static_cast<int64_t>(n));
+    state.set_bytes_processed(state.iterations() *
+                              static_cast<int64_t>(n * (2 * sizeof(T) + sizeof(size_t))));
+    state.set_label(distribution_name(dist));
+}
+
+/**
+ * @brief Counting-sort build with insert_points()
+ */
+template<typename T>
+void BM_BuildBulk(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    const Dataset<T>& points = get_fixture<T>(n, dist).points;
+
+    while (state.keep_running()) {
+        std::unique_ptr<GridIndex2D<T>> grid(make_grid(points));
+        grid->insert_points(points.x.data(), points.y.data(), n);
+        bench::do_not_optimize(*grid);
+    }
+    state.set_items_processed(state.iterations() * static_cast<int64_t>(n));
+    state.set_bytes_processed(state.iterations() *
+                              static_cast<int64_t>(n * (2 * sizeof(T) + sizeof(size_t))));
+    state.set_label(distribution_name(dist));
+}
+
+/**
+ * @brief Batched cell-id computation (the mapping pass of insert_points())
+ */
+template<typename T>
+void BM_CellIds(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    Fixture<T>& fixture = get_fixture<T>(n, dist);
+    std::vector<int> cell_ids(n);
+
+    while (state.keep_running()) {
+        fixture.grid->compute_cell_ids(fixture.points.x.data(), fixture.points.y.data(), n,
+                                       cell_ids.data());
+        bench::do_not_optimize(cell_ids.data());
+    }
+    state.set_items_processed(state.iterations() * static_cast<int64_t>(n));
+    state.set_bytes_processed(state.iterations() *
+                              static_cast<int64_t>(n * (2 * sizeof(T) + sizeof(int))));
+    state.set_label(distribution_name(dist));
+}
+
+template<typename T, int Mode>
+void BM_Query(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    const int64_t box_cells = state.range(2);
+    Fixture<T>& fixture = get_fixture<T>(n, dist);
+    const GridIndex2D<T>& grid = *fixture.grid;
+    const std::vector<T> boxes = make_boxes(fixture.points, box_cells);
+    const T* xs = fixture.points.x.data();
+    const T* ys = fixture.points.y.data();
+
+    std::vector<size_t> result;
+    result.reserve(n);
+    std::vector<std::pair<double, size_t>> distances;
+    int64_t found = 0;
+    size_t q = 0;
+
+    while (state.keep_running()) {
+        const T* b = &boxes[(q++ & (NUM_BOXES - 1)) * 4];
+        if (Mode == MODE_VECTOR) {
+            std::vector<size_t> r = grid.query_box(b[0], b[1], b[2], b[3]);
+            found += static_cast<int64_t>(r.size());
+            bench::do_not_optimize(r.data());
+        } else if (Mode == MODE_NO_ALLOC) {
+            grid.query_box_no_alloc(b[0], b[1], b[2], b[3], result);
+            found += static_cast<int64_t>(result.size());
+            bench::do_not_optimize(result.data());
+        } else if (Mode == MODE_CALLBACK) {
+            size_t sum = 0;
+            grid.query_box_callback(b[0], b[1], b[2], b[3], [&](size_t idx) {
+                sum += idx;
+                ++found;
+            });
+            bench::do_not_optimize(sum);
+        } else if (Mode == MODE_SORTED) {
+            grid.query_box_sorted(b[0], b[1], b[2], b[3], result);
+            found += static_cast<int64_t>(result.size());
+            bench::do_not_optimize(result.data());
+        } else if (Mode == MODE_NO_ALLOC_THEN_SORT) {
+            grid.query_box_no_alloc(b[0], b[1], b[2], b[3], result);
+            std::sort(result.begin(), result.end());
+            found += static_cast<int64_t>(result.size());
+            bench::do_not_optimize(result.data());
+        } else if (Mode == MODE_NEAREST) {
+            const T cx = (b[0] + b[1]) / 2, cy = (b[2] + b[3]) / 2;
+            found += static_cast<int64_t>(grid.query_box_nearest(
+                b[0], b[1], b[2], b[3], cx, cy, xs, ys, NEAREST_K, result));
+            bench::do_not_optimize(result.data());
+        } else if (Mode == MODE_NO_ALLOC_THEN_NEAREST) {
+            const double cx = (b[0] + b[1]) / 2.0, cy = (b[2] + b[3]) / 2.0;
+            grid.query_box_no_alloc(b[0], b[1], b[2], b[3], result);
+            distances.clear();
+            for (size_t idx : result) {
+                const double dx = xs[idx] - cx, dy = ys[idx] - cy;
+                distances.push_back(std::make_pair(dx * dx + dy * dy, idx));
+            }
+            const size_t k = std::min(NEAREST_K, distances.size());
+            std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+            found += static_cast<int64_t>(k);
+            bench::do_not_optimize(distances.data());
+        } else if (Mode == MODE_EXISTS || Mode == MODE_EXISTS_CENTER_OUT) {
+            const CellOrder order = Mode == MODE_EXISTS ? CellOrder::RowMajor : CellOrder::CenterOut;
+            found += grid.exists_in_box(b[0], b[1], b[2], b[3], order) ? 1 : 0;
+        } else {
+            size_t sum = 0;
+            for (size_t idx : grid.query_box_range(b[0], b[1], b[2], b[3])) {
+                sum += idx;
+                ++found;
+            }
+            bench::do_not_optimize(sum);
+        }
+    }
+    state.set_items_processed(found);
+    state.set_bytes_processed(found * static_cast<int64_t>(sizeof(size_t)));
+    state.set_label(distribution_name(dist));
+}
+
+/**
+ * @brief Linear scan over all points, the baseline the grid has to beat
+ */
+template<typename T>
+void BM_NaiveScan(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    const int64_t box_cells = state.range(2);
+    const Dataset<T>& points = get_fixture<T>(n, dist).points;
+    const std::vector<T> boxes = make_boxes(points, box_cells);
+
+    std::vector<size_t> result;
+    result.reserve(n);
+    int64_t found = 0;
+    size_t q = 0;
+
+    while (state.keep_running()) {
+        const T* b = &boxes[(q++ & (NUM_BOXES - 1)) * 4];
+        result.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (points.x[i] >= b[0] && points.x[i] <= b[1] &&
+                points.y[i] >= b[2] && points.y[i] <= b[3]) {
+                result.push_back(i);
+            }
+        }
+        found += static_cast<int64_t>(result.size());
+        bench::do_not_optimize(result.data());
+    }
+    state.set_items_processed(found);
+    state.set_bytes_processed(found * static_cast<int64_t>(sizeof(size_t)));
+    state.set_label(distribution_name(dist));
+}
+
+/**
+ * @brief Union of overlapping boxes: query_boxes_union() vs append + sort/unique
+ */
+template<typename T, bool Union>
+void BM_BoxesUnion(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    Fixture<T>& fixture = get_fixture<T>(n, dist);
+    const GridIndex2D<T>& grid = *fixture.grid;
+    const std::vector<std::vector<GridBox<T>>> groups = make_box_groups(fixture.points, state.range(2));
+
+    std::vector<size_t> result;
+    result.reserve(n);
+    int64_t found = 0;
+    size_t q = 0;
+
+    while (state.keep_running()) {
+        const std::vector<GridBox<T>>& boxes = groups[q++ & (NUM_BOXES - 1)];
+        if (Union) {
+            grid.query_boxes_union(boxes, result);
+        } else {
+            result.clear();
+            for (size_t b = 0; b < boxes.size(); ++b) {
+                grid.query_box_no_alloc(boxes[b].x1, boxes[b].x2, boxes[b].y1, boxes[b].y2,
+                                        result, true);
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+        }
+        found += static_cast<int64_t>(result.size());
+        bench::do_not_optimize(result.data());
+    }
+    state.set_items_processed(found);
+    state.set_bytes_processed(found * static_cast<int64_t>(sizeof(size_t)));
+    state.set_label(distribution_name(dist));
+}
+
+/**
+ * @brief Per-point attributes filtered by the attribute benchmarks
+ */
+struct TraceAttributes {
+    float offset;
+    float azimuth;
+};
+
+std::vector<TraceAttributes> make_attributes(size_t n) {
+    std::vector<TraceAttributes> attributes(n);
+    std::mt19937_64 gen(31337);
+    std::uniform_real_distribution<float> offset(0.0f, 4000.0f), azimuth(0.0f, 360.0f);
+    for (size_t i = 0; i < n; ++i) {
+        attributes[i].offset = offset(gen);
+        attributes[i].azimuth = azimuth(gen);
+    }
+    return attributes;
+}
+
+/**
+ * @brief Offset-range filter in a box: payloads stored in cell order vs gathered by index
+ *
+ * Payload queries a GridIndex2D<T, TraceAttributes> with query_box_payload();
+ * the baseline queries the plain grid and reads attributes[idx] for every
+ * candidate. A quarter of the offsets pass the filter.
+ */
+template<typename T, bool Payload>
+void BM_AttributeFilter(bench::State& state) {
+    typedef GridIndex2D<T, TraceAttributes> PayloadGrid;
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    Fixture<T>& fixture = get_fixture<T>(n, dist);
+    const std::vector<T> boxes = make_boxes(fixture.points, state.range(2));
+
+    static std::map<std::pair<size_t, int>, std::vector<TraceAttributes>> attribute_cache;
+    static std::map<std::pair<size_t, int>, std::unique_ptr<PayloadGrid>> grid_cache;
+    const std::pair<size_t, int> key(n, dist);
+    std::vector<TraceAttributes>& attributes = attribute_cache[key];
+    if (attributes.empty()) attributes = make_attributes(n);
+    std::unique_ptr<PayloadGrid>& payload_grid = grid_cache[key];
+    if (Payload && !payload_grid) {
+        const Dataset<T>& d = fixture.points;
+        const T step = static_cast<T>(d.cell_size);
+        payload_grid.reset(new PayloadGrid(
+            static_cast<T>(d.bounds.x_min), static_cast<T>(d.bounds.x_max), step,
+            static_cast<T>(d.bounds.y_min), static_cast<T>(d.bounds.y_max), step));
+        payload_grid->insert_points(d.x.data(), d.y.data(), attributes.data(), n);
+    }
+
+    const float min_offset = 1000.0f, max_offset = 2000.0f;
+    int64_t found = 0;
+    size_t q = 0;
+    while (state.keep_running()) {
+        const T* b = &boxes[(q++ & (NUM_BOXES - 1)) * 4];
+        size_t sum = 0;
+        if (Payload) {
+            payload_grid->query_box_payload(b[0], b[1], b[2], b[3],
+                [&](size_t idx, const TraceAttributes& a) {
+                    if (a.offset >= min_offset && a.offset < max_offset) {
+                        sum += idx;
+                        ++found;
+                    }
+                });
+        } else {
+            fixture.grid->query_box_callback(b[0], b[1], b[2], b[3], [&](size_t idx) {
+                const TraceAttributes& a = attributes[idx];
+                if (a.offset >= min_offset && a.offset < max_offset) {
+                    sum += idx;
+                    ++found;
+                }
+            });
+        }
+        bench::do_not_optimize(sum);
+    }
+    state.set_items_processed(found);
+    state.set_bytes_processed(found * static_cast<int64_t>(sizeof(size_t)));
+    state.set_label(distribution_name(dist));
+}
+
+enum WhereMode {
+    WHERE_GATHER,    // query_box_callback() + test attributes[idx]
+    WHERE_CALLBACK,  // query_box_payload() + test in the callback
+    WHERE,           // query_box_where()
+    WHERE_SUMMARY,   // query_box_where() with per-cell bounds
+    WHERE_KEY_RANGE  // query_box_key_range() on cells sorted by the attribute
+};
+
+/**
+ * @brief Attributes for the range-filter benchmarks
+ *
+ * offset is random per point, so every cell spans the full offset range.
+ * depth is a smooth function of position (a water-bottom depth), so most
+ * cells fall entirely inside or outside a depth range.
+ */
+struct SurveyAttributes {
+    float offset;
+    float depth;
+};
+
+/**
+ * @brief Attribute range filter in a box: pushdown with and without cell bounds
+ *
+ * attr 0 filters offsets in [1000, 2000] of [0, 4000); attr 1 filters
+ * depths in [150, 170] of about [0, 200].
+ */
+template<typename T, int Mode>
+void BM_AttributeWhere(bench::State& state) {
+    typedef GridIndex2D<T, SurveyAttributes> PayloadGrid;
+    const size_t n = static_cast<size_t>(state.range(0));
+    const bool depth = state.range(2) != 0;
+    Fixture<T>& fixture = get_fixture<T>(n, UNIFORM);
+    const Dataset<T>& d = fixture.points;
+    const std::vector<T> boxes = make_boxes(d, state.range(1));
+
+    static std::map<size_t, std::vector<SurveyAttributes>> attribute_cache;
+    static std::map<std::pair<size_t, int>, std::unique_ptr<PayloadGrid>> grid_cache;
+    std::vector<SurveyAttributes>& attributes = attribute_cache[n];
+    if (attributes.empty()) {
+        attributes.resize(n);
+        std::mt19937_64 gen(2718);
+        std::uniform_real_distribution<float> offset(0.0f, 4000.0f), noise(-2.0f, 2.0f);
+        for (size_t i = 0; i < n; ++i) {
+            const double x = static_cast<double>(d.x[i]), y = static_cast<double>(d.y[i]);
+            attributes[i].offset = offset(gen);
+            attributes[i].depth = static_cast<float>(100.0 + 50.0 * std::sin(x / 150.0) +
+                                                     50.0 * std::cos(y / 170.0)) + noise(gen);
+        }
+    }
+    float SurveyAttributes::* member = depth ? &SurveyAttributes::depth : &SurveyAttributes::offset;
+    // One grid in insertion order per size, plus one per attribute sorted by it
+    const int order = Mode == WHERE_KEY_RANGE ? 1 + static_cast<int>(depth) : 0;
+    std::unique_ptr<PayloadGrid>& payload_grid = grid_cache[std::make_pair(n, order)];
+    if (!payload_grid) {
+        const T step = static_cast<T>(d.cell_size);
+        payload_grid.reset(new PayloadGrid(
+            static_cast<T>(d.bounds.x_min), static_cast<T>(d.bounds.x_max), step,
+            static_cast<T>(d.bounds.y_min), static_cast<T>(d.bounds.y_max), step));
+        payload_grid->insert_points(d.x.data(), d.y.data(), attributes.data(), n);
+        if (Mode == WHERE_KEY_RANGE) payload_grid->sort_cells_by_key(member);
+    }
+    const float lo = depth ? 150.0f : 1000.0f, hi = depth ? 170.0f : 2000.0f;
+    const GridAttributeSummary<float> summary = payload_grid->summarize(member);
+
+    std::vector<size_t> result;
+    result.reserve(n);
+    int64_t found = 0;
+    size_t q = 0;
+    while (state.keep_running()) {
+        const T* b = &boxes[(q++ & (NUM_BOXES - 1)) * 4];
+        if (Mode == WHERE_GATHER || Mode == WHERE_CALLBACK) {
+            result.clear();
+            if (Mode == WHERE_GATHER) {
+                fixture.grid->query_box_callback(b[0], b[1], b[2], b[3], [&](size_t idx) {
+                    const float a = attributes[idx].*member;
+                    if (a >= lo && a <= hi) result.push_back(idx);
+                });
+            } else {
+                payload_grid->query_box_payload(b[0], b[1], b[2], b[3],
+                    [&](size_t idx, const SurveyAttributes& p) {
+                        const float a = p.*member;
+                        if (a >= lo && a <= hi) result.push_back(idx);
+                    });
+            }
+        } else if (Mode == WHERE_KEY_RANGE) {
+            payload_grid->query_box_key_range(b[0], b[1], b[2], b[3], member, lo, hi, result);
+        } else {
+            payload_grid->query_box_where(b[0], b[1], b[2], b[3], member, lo, hi, result,
+                                          Mode == WHERE_SUMMARY ? &summary : nullptr);
+        }
+        found += static_cast<int64_t>(result.size());
+        bench::do_not_optimize(result.data());
+    }
+    state.set_items_processed(found);
+    state.set_bytes_processed(found * static_cast<int64_t>(sizeof(size_t)));
+    state.set_label(depth ? "depth" : "offset");
+}
+
+const size_t NUM_EPOCHS = 16;  // Repeat surveys of the same locations
+
+/**
+ * @brief Indexes over NUM_EPOCHS repeats of one survey
+ *
+ * Epoch e has timestamp e and indices e * n + k. per_epoch is one
+ * GridIndex2D per epoch, the layout TemporalGridIndex2D replaces.
+ */
+template<typename T>
+struct TemporalFixture {
+    std::vector<std::unique_ptr<GridIndex2D<T>>> per_epoch;
+    std::unique_ptr<TemporalGridIndex2D<T>> temporal;
+};
+
+template<typename T>
+TemporalFixture<T>& get_temporal_fixture(size_t n) {
+    static std::map<size_t, std::unique_ptr<TemporalFixture<T>>> cache;
+    std::unique_ptr<TemporalFixture<T>>& slot = cache[n];
+    if (!slot) {
+        const Dataset<T>& d = get_fixture<T>(n, UNIFORM).points;
+        const T step = static_cast<T>(d.cell_size);
+        slot.reset(new TemporalFixture<T>());
+        slot->temporal.reset(new TemporalGridIndex2D<T>(
+            static_cast<T>(d.bounds.x_min), static_cast<T>(d.bounds.x_max), step,
+            static_cast<T>(d.bounds.y_min), static_cast<T>(d.bounds.y_max), step));
+        for (size_t e = 0; e < NUM_EPOCHS; ++e) {
+            slot->per_epoch.emplace_back(make_grid(d));
+            slot->per_epoch.back()->insert_points(d.x.data(), d.y.data(), n, e * n);
+            slot->temporal->append_epoch(d.x.data(), d.y.data(), static_cast<double>(e), n, e * n);
+        }
+    }
+    return *slot;
+}
+
+/**
+ * @brief Box x time window query: one index per epoch vs TemporalGridIndex2D
+ *
+ * The window covers `epochs` consecutive epochs at a varying start.
+ */
+template<typename T, bool Temporal>
+void BM_TemporalQuery(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t epochs = static_cast<size_t>(state.range(2));
+    TemporalFixture<T>& fixture = get_temporal_fixture<T>(n);
+    const std::vector<T> boxes = make_boxes(get_fixture<T>(n, UNIFORM).points, state.range(1));
+
+    std::vector<size_t> result, epoch_result;
+    int64_t found = 0;
+    size_t q = 0;
+    while (state.keep_running()) {
+        const T* b = &boxes[(q & (NUM_BOXES - 1)) * 4];
+        const size_t first = q++ % (NUM_EPOCHS - epochs + 1);
+        if (Temporal) {
+            fixture.temporal->query_box(b[0], b[1], b[2], b[3], static_cast<double>(first),
+                                        static_cast<double>(first + epochs - 1), result);
+        } else {
+            result.clear();
+            for (size_t e = first; e < first + epochs; ++e) {
+                fixture.per_epoch[e]->query_box_no_alloc(b[0], b[1], b[2], b[3], epoch_result);
+                result.insert(result.end(), epoch_result.begin(), epoch_result.end());
+            }
+        }
+        found += static_cast<int64_t>(result.size());
+        bench::do_not_optimize(result.data());
+    }
+    state.set_items_processed(found);
+    state.set_bytes_processed(found * static_cast<int64_t>(sizeof(size_t)));
+}
+
+/**
+ * @brief Ingest one epoch and drop the oldest, keeping NUM_EPOCHS epochs
+ *
+ * Per-epoch layout: build a new GridIndex2D and release the oldest one.
+ * Temporal: append_epoch() and expire_before().
+ */
+template<typename T, bool Temporal>
+void BM_TemporalIngest(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const Dataset<T>& d = get_fixture<T>(n, UNIFORM).points;
+    const T step = static_cast<T>(d.cell_size);
+    TemporalGridIndex2D<T> temporal(
+        static_cast<T>(d.bounds.x_min), static_cast<T>(d.bounds.x_max), step,
+        static_cast<T>(d.bounds.y_min), static_cast<T>(d.bounds.y_max), step);
+    std::vector<std::unique_ptr<GridIndex2D<T>>> per_epoch;
+    size_t e = 0;
+    for (; e < NUM_EPOCHS; ++e) {
+        if (Temporal) {
+            temporal.append_epoch(d.x.data(), d.y.data(), static_cast<double>(e), n, e * n);
+        } else {
+            per_epoch.emplace_back(make_grid(d));
+            per_epoch.back()->insert_points(d.x.data(), d.y.data(), n, e * n);
+        }
+    }
+
+    while (state.keep_running()) {
+        if (Temporal) {
+            temporal.append_epoch(d.x.data(), d.y.data(), static_cast<double>(e), n, e * n);
+            temporal.expire_before(static_cast<double>(e + 1 - NUM_EPOCHS));
+        } else {
+            per_epoch.erase(per_epoch.begin());
+            per_epoch.emplace_back(make_grid(d));
+            per_epoch.back()->insert_points(d.x.data(), d.y.data(), n, e * n);
+        }
+        ++e;
+        bench::do_not_optimize(temporal);
+    }
+    state.set_items_processed(state.iterations() * static_cast<int64_t>(n));
+}
+
+/**
+ * @brief Box queries on a grid far larger than the last-level cache
+ *
+ * Uniform points, about four per cell, inserted one by one so that cell
+ * storage is scattered over the heap. The 2^18 query boxes are spread
+ * over the whole grid and are not revisited for a long time, so most
+ * cells are cache misses: the case software prefetching targets. Build
+ * with -DGRID_INDEX_PREFETCH_DISTANCE=0 to compare against no prefetching.
+ */
+template<typename T>
+void BM_LargeGrid(bench::State& state) {
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int64_t box_cells = state.range(1);
+    const size_t num_boxes = size_t(1) << 18;
+
+    static std::map<size_t, std::unique_ptr<Fixture<T>>> cache;
+    std::unique_ptr<Fixture<T>>& slot = cache[n];
+    if (!slot) {
+        slot.reset(new Fixture<T>());
+        slot->points = generate_points<T>(n, UNIFORM);
+        slot->points.cell_size = DOMAIN_SIZE / std::floor(std::sqrt(n / 4.0));
+        slot->grid.reset(make_grid(slot->points));
+        for (size_t i = 0; i < n; ++i) {
+            slot->grid->insert(slot->points.x[i], slot->points.y[i], i);
+        }
+    }
+    const GridIndex2D<T>& grid = *slot->grid;
+
+    std::vector<T> boxes;
+    boxes.reserve(num_boxes * 4);
+    std::mt19937_64 gen(99);
+    std::uniform_real_distribution<double> pos(0.0, DOMAIN_SIZE);
+    const double side = static_cast<double>(box_cells) * slot->points.cell_size;
+    for (size_t q = 0; q < num_boxes; ++q) {
+        const double x = pos(gen), y = pos(gen);
+        boxes.push_back(static_cast<T>(x));
+        boxes.push_back(static_cast<T>(x + side));
+        boxes.push_back(static_cast<T>(y));
+        boxes.push_back(static_cast<T>(y + side));
+    }
+
+    std::vector<size_t> result;
+    int64_t found = 0;
+    size_t q = 0;
+    while (state.keep_running()) {
+        const T* b = &boxes[(q++ & (num_boxes - 1)) * 4];
+        grid.query_box_no_alloc(b[0], b[1], b[2], b[3], result);
+        found += static_cast<int64_t>(result.size());
+        bench::do_not_optimize(result.data());
+    }
+    state.set_items_processed(found);
+    state.set_bytes_processed(found * static_cast<int64_t>(sizeof(size_t)));
+}
+
+const std::vector<int64_t> SIZES = {10000, 100000, 1000000};
+const std::vector<int64_t> DISTRIBUTIONS = {UNIFORM, CLUSTERED, LINE_ACQUISITION, SKEWED,
+                                            LAND_ORTHOGONAL, MARINE_STREAMER, OBN_PATCHES,
+                                            CROOKED_2D};
+const std::vector<int64_t> BOX_CELLS = {1, 4, 16};
+// Integral coordinates (bin numbers) are benchmarked on the grid-like geometries
+const std::vector<int64_t> INT_DISTRIBUTIONS = {UNIFORM, LAND_ORTHOGONAL};
+
+} // namespace
+
+BENCHMARK_NAMED("build<float>", BM_Build<float>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+BENCHMARK_NAMED("build<double>", BM_Build<double>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+BENCHMARK_NAMED("build<int>", BM_Build<int>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, INT_DISTRIBUTIONS});
+
+BENCHMARK_NAMED("build_presized<float>", BM_BuildPresized<float>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+BENCHMARK_NAMED("build_presized<double>", BM_BuildPresized<double>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+BENCHMARK_NAMED("build_bulk<float>", BM_BuildBulk<float>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+BENCHMARK_NAMED("build_bulk<double>", BM_BuildBulk<double>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+
+BENCHMARK_NAMED("cell_ids<float>", BM_CellIds<float>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+BENCHMARK_NAMED("cell_ids<double>", BM_CellIds<double>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, DISTRIBUTIONS});
+BENCHMARK_NAMED("cell_ids<int>", BM_CellIds<int>)
+    ->arg_names({"n", "dist"})->args_product({SIZES, INT_DISTRIBUTIONS});
+
+BENCHMARK_NAMED("query_box<float>", (BM_Query<float, MODE_VECTOR>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box<double>", (BM_Query<double, MODE_VECTOR>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_no_alloc<float>", (BM_Query<float, MODE_NO_ALLOC>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_no_alloc<double>", (BM_Query<double, MODE_NO_ALLOC>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_no_alloc<int>", (BM_Query<int, MODE_NO_ALLOC>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, INT_DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_callback<float>", (BM_Query<float, MODE_CALLBACK>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_callback<double>", (BM_Query<double, MODE_CALLBACK>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_range<float>", (BM_Query<float, MODE_RANGE>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_range<double>", (BM_Query<double, MODE_RANGE>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_sorted<float>", (BM_Query<float, MODE_SORTED>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_then_sort<float>", (BM_Query<float, MODE_NO_ALLOC_THEN_SORT>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_nearest<float>", (BM_Query<float, MODE_NEAREST>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("query_box_then_nearest<float>", (BM_Query<float, MODE_NO_ALLOC_THEN_NEAREST>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("exists_in_box<float>", (BM_Query<float, MODE_EXISTS>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("exists_in_box_center_out<float>", (BM_Query<float, MODE_EXISTS_CENTER_OUT>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+
+BENCHMARK_NAMED("query_boxes_union<float>", (BM_BoxesUnion<float, true>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+BENCHMARK_NAMED("append_sort_unique<float>", (BM_BoxesUnion<float, false>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, DISTRIBUTIONS, BOX_CELLS});
+
+BENCHMARK_NAMED("attribute_filter_payload<float>", (BM_AttributeFilter<float, true>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, {UNIFORM, MARINE_STREAMER}, BOX_CELLS});
+BENCHMARK_NAMED("attribute_filter_gather<float>", (BM_AttributeFilter<float, false>))
+    ->arg_names({"n", "dist", "box"})->args_product({SIZES, {UNIFORM, MARINE_STREAMER}, BOX_CELLS});
+
+BENCHMARK_NAMED("where_gather<float>", (BM_AttributeWhere<float, WHERE_GATHER>))
+    ->arg_names({"n", "box", "attr"})->args_product({SIZES, BOX_CELLS, {0, 1}});
+BENCHMARK_NAMED("where_callback<float>", (BM_AttributeWhere<float, WHERE_CALLBACK>))
+    ->arg_names({"n", "box", "attr"})->args_product({SIZES, BOX_CELLS, {0, 1}});
+BENCHMARK_NAMED("query_box_where<float>", (BM_AttributeWhere<float, WHERE>))
+    ->arg_names({"n", "box", "attr"})->args_product({SIZES, BOX_CELLS, {0, 1}});
+BENCHMARK_NAMED("query_box_where_summary<float>", (BM_AttributeWhere<float, WHERE_SUMMARY>))
+    ->arg_names({"n", "box", "attr"})->args_product({SIZES, BOX_CELLS, {0, 1}});
+BENCHMARK_NAMED("query_box_key_range<float>", (BM_AttributeWhere<float, WHERE_KEY_RANGE>))
+    ->arg_names({"n", "box", "attr"})->args_product({SIZES, BOX_CELLS, {0, 1}});
+
+BENCHMARK_NAMED("temporal_per_epoch<float>", (BM_TemporalQuery<float, false>))
+    ->arg_names({"n", "box", "epochs"})->args_product({{10000, 100000}, BOX_CELLS, {1, 4, 16}});
+BENCHMARK_NAMED("temporal_query<float>", (BM_TemporalQuery<float, true>))
+    ->arg_names({"n", "box", "epochs"})->args_product({{10000, 100000}, BOX_CELLS, {1, 4, 16}});
+BENCHMARK_NAMED("temporal_ingest_per_epoch<float>", (BM_TemporalIngest<float, false>))
+    ->arg_names({"n"})->args_product({{10000, 100000}});
+BENCHMARK_NAMED("temporal_ingest<float>", (BM_TemporalIngest<float, true>))
+    ->arg_names({"n"})->args_product({{10000, 100000}});
+
+BENCHMARK_NAMED("large_grid_no_alloc<float>", BM_LargeGrid<float>)
+    ->arg_names({"n", "box"})->args_product({{32000000}, BOX_CELLS});
+
+BENCHMARK_NAMED("naive_scan<double>", BM_NaiveScan<double>)
+    ->arg_names({"n", "dist", "box"})->args_product({{10000, 100000}, {UNIFORM}, BOX_CELLS});
+
+BENCHMARK_MAIN()
@@ -14,228 +14,2372 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 /**
- * @brief 2D spatial index using a regular grid structure
+ * @brief Query instrumentation switch
  *
- * @tparam T Coordinate type (typically float or double)
+ * Define GRID_INDEX_ENABLE_QUERY_STATS before including this header (or pass
+ * -DGRID_INDEX_ENABLE_QUERY_STATS) to count per-query work. When it is not
+ * defined the counting code is removed entirely by the preprocessor.
+ */
+#ifdef GRID_INDEX_ENABLE_QUERY_STATS
+#define GRID_INDEX_STATS(statement) statement
+#else
+#define GRID_INDEX_STATS(statement)
+#endif
+
+/**
+ * @brief Work counters accumulated by the query functions
  *
- * The grid divides space into cells of uniform size. Each cell stores indices
- * of points that fall within its bounds. Box queries collect indices from all
- * cells that intersect the query rectangle.
+ * Counters are aggregated per thread over all queries of all GridIndex2D
+ * instances since the last reset. They stay zero unless the library is
+ * compiled with GRID_INDEX_ENABLE_QUERY_STATS.
+ */
+struct GridQueryStats {
+    size_t queries;              // Number of query calls
+    size_t cells_visited;        // Cells in the query cell ranges
+    size_t empty_cells_skipped;  // Visited cells that held no points
+    size_t candidates;           // Indices read from visited cells
+    size_t emitted;              // Indices delivered to the caller (not by query_box_range())
+
+    GridQueryStats()
+        : queries(0), cells_visited(0), empty_cells_skipped(0),
+          candidates(0), emitted(0) {}
+
+    GridQueryStats& operator+=(const GridQueryStats& other) {
+        queries += other.queries;
+        cells_visited += other.cells_visited;
+        empty_cells_skipped += other.empty_cells_skipped;
+        candidates += other.candidates;
+        emitted += other.emitted;
+        return *this;
+    }
+};
+
+/**
+ * @brief Per-thread query counters shared by all GridIndex2D instantiations
+ */
+inline GridQueryStats& grid_query_stats_thread_local() {
+    static thread_local GridQueryStats stats;
+    return stats;
+}
+
+/**
+ * @brief Local query counters flushed to the thread-local totals on scope exit
  *
- * Example:
- * @code
- * GridIndex2D<float> grid(0.0f, 100.0f, 1.0f,  // x: [0,100] step 1
- *                         0.0f, 100.0f, 1.0f); // y: [0,100] step 1
+ * Queries count into a stack object so the hot loops only touch registers;
+ * the thread-local totals are updated once per query.
+ */
+class GridQueryStatsRecorder {
+public:
+    GridQueryStatsRecorder() { local_.queries = 1; }
+    /** @brief Recorder for part of a query, e.g. one step of a lazy range (queries = 0) */
+    explicit GridQueryStatsRecorder(size_t queries) { local_.queries = queries; }
+    ~GridQueryStatsRecorder() { grid_query_stats_thread_local() += local_; }
+
+    void cell(size_t cell_size) {
+        ++local_.cells_visited;
+        if (cell_size == 0) ++local_.empty_cells_skipped;
+        local_.candidates += cell_size;
+    }
+
+    void emit(size_t count) { local_.emitted += count; }
+
+private:
+    GridQueryStats local_;
+};
+
+/**
+ * @brief Latency histogram switch
  *
- * // Insert points
- * grid.insert(10.5f, 20.3f, 0);
- * grid.insert(10.8f, 20.7f, 1);
+ * Define GRID_INDEX_ENABLE_LATENCY_HISTOGRAMS to time every query call and
+ * record it in the per-API histograms read by GridIndex2D::query_latency().
+ * When it is not defined no timing code is compiled into the queries.
+ */
+#ifdef GRID_INDEX_ENABLE_LATENCY_HISTOGRAMS
+#define GRID_INDEX_LATENCY(statement) statement
+#else
+#define GRID_INDEX_LATENCY(statement)
+#endif
+
+/**
+ * @brief Software prefetch distance of the query loops, in cells
  *
- * // Query box
- * auto indices = grid.query_box(10.0f, 11.0f, 20.0f, 21.0f);
- * @endcode
+ * While a query reads one cell it prefetches the index list of the cell
+ * this many positions ahead in visiting order, and on entering a row the
+ * cell headers of the next row, so that cells stored far apart in memory
+ * do not each cost a full cache miss. Define as 0 to disable.
  */
-template<typename T>
-class GridIndex2D {
+#ifndef GRID_INDEX_PREFETCH_DISTANCE
+#define GRID_INDEX_PREFETCH_DISTANCE 4
+#endif
+
+/**
+ * @brief Hint the cache line at p into all cache levels (no-op without GCC/Clang)
+ */
+inline void grid_prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 3);
+#else
+    (void)p;
+#endif
+}
+
+/**
+ * @brief Query APIs with separate latency histograms
+ */
+enum GridQueryKind {
+    GRID_QUERY_BOX = 0,       // query_box()
+    GRID_QUERY_BOX_NO_ALLOC,  // query_box_no_alloc()
+    GRID_QUERY_BOX_CALLBACK,  // query_box_callback() (includes callback time)
+    GRID_QUERY_EXISTS,        // exists_in_box()
+    GRID_QUERY_BOX_LIMIT,     // query_box_limit()
+    GRID_QUERY_BOXES_UNION,   // query_boxes_union()
+    GRID_QUERY_BOX_SORTED,    // query_box_sorted()
+    GRID_QUERY_BOX_NEAREST,   // query_box_nearest()
+    GRID_QUERY_BOX_PAYLOAD,   // query_box_payload() (includes callback time)
+    GRID_QUERY_BOX_WHERE,     // query_box_where()
+    GRID_QUERY_BOX_KEY_RANGE, // query_box_key_range()
+    GRID_QUERY_BOX_TIME,      // TemporalGridIndex2D::query_box()
+    GRID_QUERY_KIND_COUNT
+};
+
+/**
+ * @brief Percentile summary of a latency histogram (all values in ns)
+ */
+struct LatencySummary {
+    uint64_t count;
+    double mean_ns;
+    uint64_t min_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+};
+
+/**
+ * @brief HDR-style log-linear latency histogram
+ *
+ * Values below 64 ns are counted exactly; above that every power-of-two
+ * range is split into 32 linear sub-buckets, so any recorded value is known
+ * to within 1/32 (~3%). Values of 2^40 ns (about 18 minutes) or more are
+ * counted in the last bucket. Percentiles report the upper bound of the
+ * bucket holding the requested rank.
+ */
+class LatencyHistogram {
 public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 40;
+    static const int NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram() : counts_(NUM_BUCKETS, 0), count_(0), sum_(0) {}
+
     /**
-     * @brief Construct a new Grid Index 2D object
+     * @brief Bucket holding value v
+     */
+    static int bucket_index(uint64_t v) {
+        const uint64_t max_value = (uint64_t(1) << MAX_EXPONENT) - 1;
+        if (v > max_value) v = max_value;
+        if (v < uint64_t(2 * SUB_BUCKETS)) return static_cast<int>(v);
+        int msb = 63;
+        while (!(v >> msb)) --msb;
+        const int shift = msb - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<int>((v >> shift) - SUB_BUCKETS);
+    }
+
+    /**
+     * @brief Smallest value counted in bucket idx
+     */
+    static uint64_t bucket_lower(int idx) {
+        if (idx < 2 * SUB_BUCKETS) return static_cast<uint64_t>(idx);
+        const int shift = idx / SUB_BUCKETS - 1;
+        return static_cast<uint64_t>(idx % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    }
+
+    /**
+     * @brief Largest value counted in bucket idx
+     */
+    static uint64_t bucket_upper(int idx) {
+        if (idx < 2 * SUB_BUCKETS) return static_cast<uint64_t>(idx);
+        const int shift = idx / SUB_BUCKETS - 1;
+        return bucket_lower(idx) + (uint64_t(1) << shift) - 1;
+    }
+
+    void record(uint64_t ns) {
+        ++counts_[bucket_index(ns)];
+        ++count_;
+        sum_ += ns;
+    }
+
+    void add_bucket(int idx, uint64_t n) {
+        counts_[idx] += n;
+        count_ += n;
+    }
+
+    void add_sum(uint64_t ns) { sum_ += ns; }
+
+    void merge(const LatencyHistogram& other) {
+        for (int b = 0; b < NUM_BUCKETS; ++b) counts_[b] += other.counts_[b];
+        count_ += other.count_;
+        sum_ += other.sum_;
+    }
+
+    /**
+     * @brief Remove the samples of an earlier snapshot of the same source
+     */
+    void subtract(const LatencyHistogram& earlier) {
+        for (int b = 0; b < NUM_BUCKETS; ++b) counts_[b] -= earlier.counts_[b];
+        count_ -= earlier.count_;
+        sum_ -= earlier.sum_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t bucket_count(int idx) const { return counts_[idx]; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    /**
+     * @brief Value at or below which the fraction q of samples lie (q in [0, 1])
+     */
+    uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count_)));
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < NUM_BUCKETS; ++b) {
+            seen += counts_[b];
+            if (seen >= rank) return bucket_upper(b);
+        }
+        return bucket_upper(NUM_BUCKETS - 1);
+    }
+
+    LatencySummary summary() const {
+        LatencySummary s;
+        s.count = count_;
+        s.mean_ns = mean();
+        s.min_ns = 0;
+        for (int b = 0; b < NUM_BUCKETS; ++b) {
+            if (counts_[b]) { s.min_ns = bucket_lower(b); break; }
+        }
+        s.p50_ns = percentile(0.50);
+        s.p90_ns = percentile(0.90);
+        s.p99_ns = percentile(0.99);
+        s.p999_ns = percentile(0.999);
+        s.max_ns = percentile(1.0);
+        return s;
+    }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+};
+
+/**
+ * @brief One thread's latency counters for every query kind
+ *
+ * Only the owning thread writes a shard, so recording is a relaxed load and
+ * store per counter (no locked read-modify-write); readers merge all shards
+ * with relaxed loads.
+ */
+struct GridLatencyShard {
+    std::atomic<uint64_t> counts[GRID_QUERY_KIND_COUNT][LatencyHistogram::NUM_BUCKETS];
+    std::atomic<uint64_t> sums[GRID_QUERY_KIND_COUNT];
+    bool in_use;  // Guarded by the registry mutex
+
+    void record(GridQueryKind kind, uint64_t ns) {
+        std::atomic<uint64_t>& c = counts[kind][LatencyHistogram::bucket_index(ns)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sums[kind].store(sums[kind].load(std::memory_order_relaxed) + ns,
+                         std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Owner of all latency shards
+ *
+ * A thread takes a shard on its first recorded query and hands it back on
+ * exit; the shard keeps its counts and is reused by the next new thread, so
+ * memory is bounded by the peak number of querying threads. The mutex is
+ * taken only for shard hand-over, reads and resets, never per sample.
+ */
+class GridLatencyRegistry {
+public:
+    GridLatencyShard* acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            if (!shards_[s]->in_use) {
+                shards_[s]->in_use = true;
+                return shards_[s].get();
+            }
+        }
+        shards_.push_back(std::unique_ptr<GridLatencyShard>(new GridLatencyShard()));
+        shards_.back()->in_use = true;
+        return shards_.back().get();
+    }
+
+    void release(GridLatencyShard* shard) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shard->in_use = false;
+    }
+
+    /**
+     * @brief Merge all shards of one query kind, minus the last reset point
+     */
+    LatencyHistogram snapshot(GridQueryKind kind) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        LatencyHistogram h = merged(kind);
+        h.subtract(baseline_[kind]);
+        return h;
+    }
+
+    /**
+     * @brief Start counting from zero
+     *
+     * Shards are never cleared (their owners may be writing); instead the
+     * current totals become the baseline subtracted by snapshot().
+     */
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int k = 0; k < GRID_QUERY_KIND_COUNT; ++k) {
+            baseline_[k] = merged(static_cast<GridQueryKind>(k));
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<GridLatencyShard>> shards_;
+    LatencyHistogram baseline_[GRID_QUERY_KIND_COUNT];
+
+    LatencyHistogram merged(GridQueryKind kind) const {
+        LatencyHistogram h;
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            const GridLatencyShard& shard = *shards_[s];
+            for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; ++b) {
+                uint64_t n = shard.counts[kind][b].load(std::memory_order_relaxed);
+                if (n) h.add_bucket(b, n);
+            }
+            h.add_sum(shard.sums[kind].load(std::memory_order_relaxed));
+        }
+        return h;
+    }
+};
+
+/**
+ * @brief Process-wide latency registry
+ *
+ * Intentionally leaked so that threads exiting during static destruction
+ * can still hand back their shards.
+ */
+inline GridLatencyRegistry& grid_latency_registry() {
+    static GridLatencyRegistry* registry = new GridLatencyRegistry();
+    return *registry;
+}
+
+/**
+ * @brief Record one query latency into the calling thread's shard
+ */
+inline void record_grid_query_latency(GridQueryKind kind, uint64_t ns) {
+    struct ShardHandle {
+        GridLatencyShard* shard;
+        ShardHandle() : shard(grid_latency_registry().acquire()) {}
+        ~ShardHandle() { grid_latency_registry().release(shard); }
+    };
+    static thread_local ShardHandle handle;
+    handle.shard->record(kind, ns);
+}
+
+/**
+ * @brief Times a query from construction to destruction
+ */
+class GridLatencyTimer {
+public:
+    explicit GridLatencyTimer(GridQueryKind kind)
+        : kind_(kind), start_(std::chrono::steady_clock::now()) {}
+
+    ~GridLatencyTimer() {
+        const std::chrono::steady_clock::duration elapsed =
+            std::chrono::steady_clock::now() - start_;
+        record_grid_query_latency(kind_, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+private:
+    GridQueryKind kind_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief Memory footprint of a GridIndex2D in bytes
+ *
+ * "used" counts live elements, "reserved" counts allocated capacity, so
+ * reserved - used is the slack left by vector growth. Heap allocator
+ * bookkeeping (typically 8-16 bytes per non-empty cell) is not included.
+ */
+struct GridMemoryUsage {
+    size_t object_bytes;          // sizeof(GridIndex2D)
+    size_t cell_headers_used;     // One std::vector header per cell
+    size_t cell_headers_reserved;
+    size_t indices_used;          // Stored point indices
+    size_t indices_reserved;      // Allocated capacity of all cell vectors
+    size_t payloads_used;         // Payload headers and values (0 without Payload)
+    size_t payloads_reserved;
+
+    size_t total_used() const {
+        return object_bytes + cell_headers_used + indices_used + payloads_used;
+    }
+    size_t total_reserved() const {
+        return object_bytes + cell_headers_reserved + indices_reserved + payloads_reserved;
+    }
+};
+
+/**
+ * @brief Distribution of points over grid cells
+ */
+struct GridOccupancy {
+    size_t num_cells;
+    size_t num_points;
+    size_t empty_cells;
+    size_t max_cell_size;
+    double mean_cell_size;  // Over all cells, including empty ones
+    size_t p50_cell_size;
+    size_t p90_cell_size;
+    size_t p99_cell_size;
+    /**
+     * size_histogram[0] counts empty cells, size_histogram[k] for k >= 1
+     * counts cells holding [2^(k-1), 2^k) points.
+     */
+    std::vector<size_t> size_histogram;
+};
+
+/**
+ * @brief SIMD switch
+ *
+ * On x86-64 with GCC or Clang, GridIndex2D::compute_cell_ids() maps float and
+ * double coordinates with AVX-512 or AVX2 kernels, chosen once at run time
+ * from the CPU's features; the rest of the header needs no special compiler
+ * flags. Define GRID_INDEX_DISABLE_SIMD to compile only the scalar loop.
+ */
+#if !defined(GRID_INDEX_DISABLE_SIMD) && defined(__x86_64__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define GRID_INDEX_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Instruction set used by the batched cell-id kernels
+ */
+enum GridSimdLevel {
+    GRID_SIMD_NONE = 0,
+    GRID_SIMD_AVX2,
+    GRID_SIMD_AVX512
+};
+
+/**
+ * @brief Best kernel level supported by this build and CPU (detected once)
+ */
+inline GridSimdLevel grid_simd_level() {
+#ifdef GRID_INDEX_X86_SIMD
+    static const GridSimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return GRID_SIMD_AVX512;
+        if (__builtin_cpu_supports("avx2")) return GRID_SIMD_AVX2;
+        return GRID_SIMD_NONE;
+    }();
+    return level;
+#else
+    return GRID_SIMD_NONE;
+#endif
+}
+
+/**
+ * @brief Cell mapping parameters of one grid axis
+ */
+template<typename T>
+struct GridCellAxis {
+    T start;
+    T step;
+    T inv_step;  // 1 / step (floating-point T only)
+    int shift;   // log2(step) for a power-of-two integral step, else -1
+    uint64_t magic;  // ceil(2^64 / step) for other integral steps, else 0
+    int n;       // Number of cells
+};
+
+/**
+ * @brief Coordinate to cell index arithmetic of one axis
+ *
+ * Cell i holds the coordinates with start + i * step <= x < start + (i + 1) * step.
+ * floor_cell() returns the unclamped cell index limited to [-1, n] (anything
+ * further out clamps to the same edge cell); on_edge() tells whether x lies
+ * exactly on the lower edge of cell i. Floating-point and integral
+ * coordinate types have separate implementations below.
+ */
+template<typename T, bool Integral = std::is_integral<T>::value>
+struct GridAxisMath;
+
+/**
+ * @brief Floating-point coordinates: reciprocal multiply with exact correction
+ *
+ * Edges are the products i * step rounded to T, so a coordinate exactly on
+ * a cell edge belongs to the upper cell. The product with the precomputed
+ * reciprocal only estimates i (the reciprocal is rounded); one comparison
+ * with the cell edges corrects it, replacing the division and std::floor.
+ * The [-1, n] limit keeps the int conversion defined. NaN maps to -1.
+ */
+template<typename T>
+struct GridAxisMath<T, false> {
+    static GridCellAxis<T> make_axis(T start, T end, T step) {
+        GridCellAxis<T> a = {start, step, T(1) / step, -1, 0,
+                             static_cast<int>(std::ceil((end - start) / step))};
+        return a;
+    }
+
+    static int floor_cell(T x, const GridCellAxis<T>& a) {
+        const T d = x - a.start;
+        const T q = d * a.inv_step;
+        if (!(q > T(-1))) return -1;
+        if (q >= static_cast<T>(a.n + 1)) return a.n;
+        int i = static_cast<int>(q);  // Truncation; the correction below handles (-1, 0)
+        if (d < static_cast<T>(i) * a.step) {
+            --i;
+        } else if (d >= static_cast<T>(i + 1) * a.step) {
+            ++i;
+        }
+        return i;
+    }
+
+    static bool on_edge(T x, int i, const GridCellAxis<T>& a) {
+        return x - a.start == static_cast<T>(i) * a.step;
+    }
+};
+
+/**
+ * @brief Integral coordinates (e.g. inline/crossline numbers): exact integer math
+ *
+ * Offsets are taken in 64 bits, so x - start must fit in int64_t. A
+ * power-of-two step is a shift. Other steps divide offsets below 2^32 by
+ * multiplying with ceil(2^64 / step) and keeping the high 64 bits, which is
+ * exact for 32-bit dividends and divisors (Lemire, Kaser & Kurz, "Faster
+ * remainder by direct computation", 2019); larger offsets fall back to a
+ * division. No floating-point conversions.
+ */
+template<typename T>
+struct GridAxisMath<T, true> {
+    static GridCellAxis<T> make_axis(T start, T end, T step) {
+        const int64_t extent = static_cast<int64_t>(end) - static_cast<int64_t>(start);
+        const uint64_t s = static_cast<uint64_t>(step);
+        int shift = -1;
+        uint64_t magic = 0;
+        if ((s & (s - 1)) == 0) {
+            shift = 0;
+            while ((uint64_t(1) << shift) < s) ++shift;
+        } else if (s <= 0xFFFFFFFFu) {
+            magic = UINT64_MAX / s + 1;
+        }
+        GridCellAxis<T> a = {start, step, T(0), shift, magic,
+                             static_cast<int>((extent + static_cast<int64_t>(s) - 1) /
+                                              static_cast<int64_t>(s))};
+        return a;
+    }
+
+    static int floor_cell(T x, const GridCellAxis<T>& a) {
+        const int64_t d = static_cast<int64_t>(x) - static_cast<int64_t>(a.start);
+        if (d < 0) return -1;  // floor(d / step) <= -1 for any negative offset
+        uint64_t i;
+        if (a.shift >= 0) {
+            i = static_cast<uint64_t>(d) >> a.shift;
+        } else if (a.magic != 0 && d <= 0xFFFFFFFF) {
+            i = mul_high(a.magic, static_cast<uint64_t>(d));
+        } else {
+            i = static_cast<uint64_t>(d) / static_cast<uint64_t>(a.step);
+        }
+        return i > static_cast<uint64_t>(a.n) ? a.n : static_cast<int>(i);
+    }
+
+    static bool on_edge(T x, int i, const GridCellAxis<T>& a) {
+        return static_cast<int64_t>(x) - static_cast<int64_t>(a.start) ==
+               static_cast<int64_t>(i) * static_cast<int64_t>(a.step);
+    }
+
+    /** @brief High 64 bits of m * d for d < 2^32 */
+    static uint64_t mul_high(uint64_t m, uint64_t d) {
+        const uint64_t low = (m & 0xFFFFFFFFu) * d;
+        return ((m >> 32) * d + (low >> 32)) >> 32;
+    }
+};
+
+/**
+ * @brief Vectorized cell ids for float/double coordinates
+ *
+ * Computes out[k] = j * nx + i for a prefix of the n points and returns its
+ * length; the caller maps the remaining points with the scalar code. The
+ * kernels follow the floating-point GridAxisMath operation by operation
+ * (offset, reciprocal estimate clamped to [-1, n], truncation, one
+ * correction against the edge products, clamp to the grid), so both give
+ * identical ids including for NaN and out-of-range coordinates. Other coordinate types
+ * have no kernel and return 0.
+ */
+template<typename T>
+inline size_t grid_cell_ids_simd(const T*, const T*, size_t,
+                                 const GridCellAxis<T>&, const GridCellAxis<T>&, int*) {
+    return 0;
+}
+
+#ifdef GRID_INDEX_X86_SIMD
+
+__attribute__((target("avx2")))
+inline __m256 grid_floor_cell_avx2(__m256 v, const GridCellAxis<float>& a) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 step = _mm256_set1_ps(a.step);
+    const __m256 d = _mm256_sub_ps(v, _mm256_set1_ps(a.start));
+    // max(q, -1) returns -1 for NaN, matching the scalar !(q > -1) test
+    __m256 q = _mm256_max_ps(_mm256_mul_ps(d, _mm256_set1_ps(a.inv_step)), _mm256_set1_ps(-1.0f));
+    q = _mm256_min_ps(q, _mm256_set1_ps(static_cast<float>(a.n)));
+    __m256 i = _mm256_round_ps(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256 below = _mm256_cmp_ps(d, _mm256_mul_ps(i, step), _CMP_LT_OQ);
+    const __m256 above = _mm256_cmp_ps(d, _mm256_mul_ps(_mm256_add_ps(i, one), step), _CMP_GE_OQ);
+    i = _mm256_sub_ps(i, _mm256_and_ps(below, one));
+    i = _mm256_add_ps(i, _mm256_and_ps(above, one));
+    i = _mm256_max_ps(i, _mm256_setzero_ps());
+    return _mm256_min_ps(i, _mm256_set1_ps(static_cast<float>(a.n - 1)));
+}
+
+__attribute__((target("avx2")))
+inline __m256d grid_floor_cell_avx2(__m256d v, const GridCellAxis<double>& a) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d step = _mm256_set1_pd(a.step);
+    const __m256d d = _mm256_sub_pd(v, _mm256_set1_pd(a.start));
+    __m256d q = _mm256_max_pd(_mm256_mul_pd(d, _mm256_set1_pd(a.inv_step)), _mm256_set1_pd(-1.0));
+    q = _mm256_min_pd(q, _mm256_set1_pd(static_cast<double>(a.n)));
+    __m256d i = _mm256_round_pd(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256d below = _mm256_cmp_pd(d, _mm256_mul_pd(i, step), _CMP_LT_OQ);
+    const __m256d above = _mm256_cmp_pd(d, _mm256_mul_pd(_mm256_add_pd(i, one), step), _CMP_GE_OQ);
+    i = _mm256_sub_pd(i, _mm256_and_pd(below, one));
+    i = _mm256_add_pd(i, _mm256_and_pd(above, one));
+    i = _mm256_max_pd(i, _mm256_setzero_pd());
+    return _mm256_min_pd(i, _mm256_set1_pd(static_cast<double>(a.n - 1)));
+}
+
+// Cell indices are exact small integers in the FP lanes, so j * nx + i is
+// formed in integer lanes for float (ids can exceed 2^24) and in double
+// lanes for double (exact below 2^53) before the final conversion.
+
+__attribute__((target("avx2")))
+inline size_t grid_cell_ids_avx2(const float* xs, const float* ys, size_t n,
+                                 const GridCellAxis<float>& ax, const GridCellAxis<float>& ay,
+                                 int* out) {
+    const __m256i nx = _mm256_set1_epi32(ax.n);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        const __m256i i = _mm256_cvttps_epi32(grid_floor_cell_avx2(_mm256_loadu_ps(xs + k), ax));
+        const __m256i j = _mm256_cvttps_epi32(grid_floor_cell_avx2(_mm256_loadu_ps(ys + k), ay));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k),
+                            _mm256_add_epi32(_mm256_mullo_epi32(j, nx), i));
+    }
+    return k;
+}
+
+__attribute__((target("avx2")))
+inline size_t grid_cell_ids_avx2(const double* xs, const double* ys, size_t n,
+                                 const GridCellAxis<double>& ax, const GridCellAxis<double>& ay,
+                                 int* out) {
+    const __m256d nx = _mm256_set1_pd(static_cast<double>(ax.n));
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const __m256d i = grid_floor_cell_avx2(_mm256_loadu_pd(xs + k), ax);
+        const __m256d j = grid_floor_cell_avx2(_mm256_loadu_pd(ys + k), ay);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k),
+                         _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(j, nx), i)));
+    }
+    return k;
+}
+
+// GCC 12 reports the _mm512_undefined_*() pass-through operands inside the
+// AVX-512 intrinsics as maybe-uninitialized once they are inlined here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+__attribute__((target("avx512f")))
+inline __m512 grid_floor_cell_avx512(__m512 v, const GridCellAxis<float>& a) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 step = _mm512_set1_ps(a.step);
+    const __m512 d = _mm512_sub_ps(v, _mm512_set1_ps(a.start));
+    __m512 q = _mm512_max_ps(_mm512_mul_ps(d, _mm512_set1_ps(a.inv_step)), _mm512_set1_ps(-1.0f));
+    q = _mm512_min_ps(q, _mm512_set1_ps(static_cast<float>(a.n)));
+    __m512 i = _mm512_roundscale_ps(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __mmask16 below = _mm512_cmp_ps_mask(d, _mm512_mul_ps(i, step), _CMP_LT_OQ);
+    const __mmask16 above = _mm512_cmp_ps_mask(d, _mm512_mul_ps(_mm512_add_ps(i, one), step), _CMP_GE_OQ);
+    i = _mm512_mask_sub_ps(i, below, i, one);
+    i = _mm512_mask_add_ps(i, above, i, one);
+    i = _mm512_max_ps(i, _mm512_setzero_ps());
+    return _mm512_min_ps(i, _mm512_set1_ps(static_cast<float>(a.n - 1)));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d grid_floor_cell_avx512(__m512d v, const GridCellAxis<double>& a) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d step = _mm512_set1_pd(a.step);
+    const __m512d d = _mm512_sub_pd(v, _mm512_set1_pd(a.start));
+    __m512d q = _mm512_max_pd(_mm512_mul_pd(d, _mm512_set1_pd(a.inv_step)), _mm512_set1_pd(-1.0));
+    q = _mm512_min_pd(q, _mm512_set1_pd(static_cast<double>(a.n)));
+    __m512d i = _mm512_roundscale_pd(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __mmask8 below = _mm512_cmp_pd_mask(d, _mm512_mul_pd(i, step), _CMP_LT_OQ);
+    const __mmask8 above = _mm512_cmp_pd_mask(d, _mm512_mul_pd(_mm512_add_pd(i, one), step), _CMP_GE_OQ);
+    i = _mm512_mask_sub_pd(i, below, i, one);
+    i = _mm512_mask_add_pd(i, above, i, one);
+    i = _mm512_max_pd(i, _mm512_setzero_pd());
+    return _mm512_min_pd(i, _mm512_set1_pd(static_cast<double>(a.n - 1)));
+}
+
+__attribute__((target("avx512f")))
+inline size_t grid_cell_ids_avx512(const float* xs, const float* ys, size_t n,
+                                   const GridCellAxis<float>& ax, const GridCellAxis<float>& ay,
+                                   int* out) {
+    const __m512i nx = _mm512_set1_epi32(ax.n);
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        const __m512i i = _mm512_cvttps_epi32(grid_floor_cell_avx512(_mm512_loadu_ps(xs + k), ax));
+        const __m512i j = _mm512_cvttps_epi32(grid_floor_cell_avx512(_mm512_loadu_ps(ys + k), ay));
+        _mm512_storeu_si512(out + k, _mm512_add_epi32(_mm512_mullo_epi32(j, nx), i));
+    }
+    return k;
+}
+
+__attribute__((target("avx512f")))
+inline size_t grid_cell_ids_avx512(const double* xs, const double* ys, size_t n,
+                                   const GridCellAxis<double>& ax, const GridCellAxis<double>& ay,
+                                   int* out) {
+    const __m512d nx = _mm512_set1_pd(static_cast<double>(ax.n));
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        const __m512d i = grid_floor_cell_avx512(_mm512_loadu_pd(xs + k), ax);
+        const __m512d j = grid_floor_cell_avx512(_mm512_loadu_pd(ys + k), ay);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k),
+                            _mm512_cvttpd_epi32(_mm512_add_pd(_mm512_mul_pd(j, nx), i)));
+    }
+    return k;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+inline size_t grid_cell_ids_simd(const float* xs, const float* ys, size_t n,
+                                 const GridCellAxis<float>& ax, const GridCellAxis<float>& ay,
+                                 int* out) {
+    switch (grid_simd_level()) {
+    case GRID_SIMD_AVX512: return grid_cell_ids_avx512(xs, ys, n, ax, ay, out);
+    case GRID_SIMD_AVX2: return grid_cell_ids_avx2(xs, ys, n, ax, ay, out);
+    default: return 0;
+    }
+}
+
+inline size_t grid_cell_ids_simd(const double* xs, const double* ys, size_t n,
+                                 const GridCellAxis<double>& ax, const GridCellAxis<double>& ay,
+                                 int* out) {
+    switch (grid_simd_level()) {
+    case GRID_SIMD_AVX512: return grid_cell_ids_avx512(xs, ys, n, ax, ay, out);
+    case GRID_SIMD_AVX2: return grid_cell_ids_avx2(xs, ys, n, ax, ay, out);
+    default: return 0;
+    }
+}
+
+#endif // GRID_INDEX_X86_SIMD
+
+/**
+ * @brief Box edge modes for the compile-time query overloads
+ *
+ * query_box<Edges::HalfOpen>(...) is equivalent to query_box(..., true, false)
+ * but resolves the edge handling at compile time; the inclusive mode then
+ * carries no boundary tests at all.
+ */
+enum class Edges {
+    Inclusive,       // [x1, x2] x [y1, y2]
+    Exclusive,       // (x1, x2) x (y1, y2)
+    HalfOpen,        // [x1, x2) x [y1, y2)
+    ReverseHalfOpen  // (x1, x2] x (y1, y2]
+};
+
+/**
+ * @brief Edge flags of an Edges mode
+ */
+template<Edges E>
+struct GridEdgeFlags {
+    static const bool include_min = E == Edges::Inclusive || E == Edges::HalfOpen;
+    static const bool include_max = E == Edges::Inclusive || E == Edges::ReverseHalfOpen;
+};
+
+/**
+ * @brief Edges mode of a pair of runtime edge flags
+ */
+inline Edges grid_edges(bool include_min, bool include_max) {
+    if (include_min) return include_max ? Edges::Inclusive : Edges::HalfOpen;
+    return include_max ? Edges::ReverseHalfOpen : Edges::Exclusive;
+}
+
+/**
+ * @brief Axis-aligned query box, for queries taking several boxes
+ */
+template<typename T>
+struct GridBox {
+    T x1, x2;  // x extent (either order)
+    T y1, y2;  // y extent (either order)
+};
+
+/**
+ * @brief Return value of callbacks that can end a query early
+ */
+enum class Visit {
+    Continue,
+    Stop
+};
+
+/**
+ * @brief Deliver one index to a query callback
+ *
+ * Callbacks may return void (always continue) or Visit.
+ * @return false if the callback asked to stop
+ */
+template<typename Callback>
+inline auto grid_visit(Callback& callback, size_t index)
+    -> typename std::enable_if<std::is_void<decltype(callback(index))>::value, bool>::type {
+    callback(index);
+    return true;
+}
+
+template<typename Callback>
+inline auto grid_visit(Callback& callback, size_t index)
+    -> typename std::enable_if<!std::is_void<decltype(callback(index))>::value, bool>::type {
+    return callback(index) != Visit::Stop;
+}
+
+/**
+ * @brief Deliver one index and its payload to a query callback
+ */
+template<typename Callback, typename P>
+inline auto grid_visit(Callback& callback, size_t index, const P& payload)
+    -> typename std::enable_if<std::is_void<decltype(callback(index, payload))>::value, bool>::type {
+    callback(index, payload);
+    return true;
+}
+
+template<typename Callback, typename P>
+inline auto grid_visit(Callback& callback, size_t index, const P& payload)
+    -> typename std::enable_if<!std::is_void<decltype(callback(index, payload))>::value, bool>::type {
+    return callback(index, payload) != Visit::Stop;
+}
+
+/**
+ * @brief Order in which early-terminating queries visit the cells of a box
+ */
+enum class CellOrder {
+    RowMajor,  // Row by row from the lower-left cell, as query_box()
+    CenterOut  // Rings of growing distance around the box's middle cell
+};
+
+/**
+ * @brief Payload type of a GridIndex2D without payloads
+ */
+struct GridNoPayload {};
+
+/**
+ * @brief Per-cell payload storage of GridIndex2D, parallel to the index lists
+ *
+ * cells[c][k] belongs to the k-th index of cell c. The void
+ * specialization stores nothing and compiles every operation away.
+ */
+template<typename Payload>
+struct GridPayloadCells {
+    typedef Payload value_type;
+    std::vector<std::vector<Payload>> cells;
+
+    void resize(size_t n) { cells.resize(n); }
+    void push(size_t c, const Payload& payload) { cells[c].push_back(payload); }
+    void reserve(size_t c, size_t n) { cells[c].reserve(n); }
+    const Payload* data(size_t c) const { return cells[c].data(); }
+
+    void clear(bool release_memory) {
+        for (auto& cell : cells) {
+            if (release_memory) {
+                std::vector<Payload>().swap(cell);
+            } else {
+                cell.clear();
+            }
+        }
+    }
+
+    void shrink_to_fit() {
+        for (auto& cell : cells) {
+            if (cell.capacity() != cell.size()) {
+                std::vector<Payload>(cell).swap(cell);
+            }
+        }
+    }
+
+    /**
+     * @brief Sort the indices of cell c, moving its payloads along (stable)
+     */
+    void sort_cell(size_t c, std::vector<size_t>& indices) {
+        sort_cell_by(c, indices, [&](size_t a, size_t b) { return indices[a] < indices[b]; });
+    }
+
+    /**
+     * @brief Stable-sort entries [first, end) of cell c by less(a, b) on entry positions
+     *
+     * Indices and payloads move together; entries before first stay in place.
+     */
+    template<typename Less>
+    void sort_cell_by(size_t c, std::vector<size_t>& indices, Less less, size_t first = 0) {
+        std::vector<Payload>& payloads = cells[c];
+        std::vector<size_t> order(indices.size() - first);
+        for (size_t k = 0; k < order.size(); ++k) order[k] = first + k;
+        std::stable_sort(order.begin(), order.end(), less);
+        const std::vector<size_t> old_indices(indices.begin() + first, indices.end());
+        const std::vector<Payload> old_payloads(payloads.begin() + first, payloads.end());
+        for (size_t k = 0; k < order.size(); ++k) {
+            indices[first + k] = old_indices[order[k] - first];
+            payloads[first + k] = old_payloads[order[k] - first];
+        }
+    }
+
+    void usage(size_t& used, size_t& reserved) const {
+        used = cells.size() * sizeof(std::vector<Payload>);
+        reserved = cells.capacity() * sizeof(std::vector<Payload>);
+        for (const auto& cell : cells) {
+            used += cell.size() * sizeof(Payload);
+            reserved += cell.capacity() * sizeof(Payload);
+        }
+    }
+};
+
+template<>
+struct GridPayloadCells<void> {
+    typedef GridNoPayload value_type;
+
+    void resize(size_t) {}
+    void push(size_t, const GridNoPayload&) {}
+    void reserve(size_t, size_t) {}
+    const GridNoPayload* data(size_t) const { return nullptr; }
+    void clear(bool) {}
+    void shrink_to_fit() {}
+    void sort_cell(size_t, std::vector<size_t>& indices) {
+        std::sort(indices.begin(), indices.end());
+    }
+    void usage(size_t& used, size_t& reserved) const {
+        used = 0;
+        reserved = 0;
+    }
+};
+
+/**
+ * @brief Read an attribute of a payload through a data member pointer, e.g. &Trace::offset
+ */
+template<typename P, typename A>
+inline const A& grid_attribute(A P::* member, const P& payload) {
+    return payload.*member;
+}
+
+/**
+ * @brief Read an attribute of a payload through a function or lambda: A(const P&)
+ */
+template<typename Getter, typename P>
+inline auto grid_attribute(const Getter& get, const P& payload) -> decltype(get(payload)) {
+    return get(payload);
+}
+
+/**
+ * @brief Value type of the attribute Getter reads from a payload P
+ */
+template<typename Getter, typename P>
+struct GridAttributeType {
+    typedef typename std::decay<decltype(grid_attribute(std::declval<const Getter&>(),
+                                                        std::declval<const P&>()))>::type type;
+};
+
+/**
+ * @brief Whether a lies in [lo, hi]; lo > hi selects the wrapped range [lo, +inf) and (-inf, hi]
+ *
+ * Wrapped ranges express cyclic attributes such as azimuths from 350 to 10 degrees.
+ */
+template<typename A>
+inline bool grid_in_range(const A& a, const A& lo, const A& hi) {
+    return lo <= hi ? (lo <= a && a <= hi) : (lo <= a || a <= hi);
+}
+
+/**
+ * @brief Minimum and maximum of one payload attribute over a cell
+ */
+template<typename A>
+struct GridCellBounds {
+    A min;
+    A max;
+
+    /** @brief Whether some value in [min, max] may lie in the range */
+    bool may_match(const A& lo, const A& hi) const {
+        return lo <= hi ? (lo <= max && min <= hi) : (lo <= max || min <= hi);
+    }
+    /** @brief Whether every value in [min, max] lies in the range */
+    bool all_match(const A& lo, const A& hi) const {
+        return lo <= hi ? (lo <= min && max <= hi) : (lo <= min || max <= hi);
+    }
+};
+
+/**
+ * @brief Per-cell bounds of one payload attribute, built by GridIndex2D::summarize()
+ *
+ * query_box_where() uses it to skip cells that cannot match and to copy
+ * cells that match entirely without reading their payloads. A summary
+ * describes the grid as it was when built; once points are inserted or
+ * cleared, queries reject it until it is rebuilt.
+ */
+template<typename A>
+class GridAttributeSummary {
+public:
+    GridAttributeSummary() : version_(0) {}
+
+    /** @brief Bounds of the cell with linear id j * nx + i (empty cells: min > max) */
+    const GridCellBounds<A>& cell(size_t cell_id) const {
+        return cells_[cell_id];
+    }
+
+    size_t get_num_cells() const {
+        return cells_.size();
+    }
+
+private:
+    template<typename, typename> friend class GridIndex2D;
+
+    std::vector<GridCellBounds<A>> cells_;
+    size_t version_;  // GridIndex2D modification count at build time
+};
+
+/**
+ * @brief 2D spatial index using a regular grid structure
+ *
+ * @tparam T Coordinate type (typically float or double)
+ * @tparam Payload Optional fixed-size record stored with every index, in
+ *         cell order, and handed to query_box_payload() callbacks; void
+ *         (default) stores indices only
+ *
+ * The grid divides space into cells of uniform size. Each cell stores indices
+ * of points that fall within its bounds. Box queries collect indices from all
+ * cells that intersect the query rectangle.
+ *
+ * Example:
+ * @code
+ * GridIndex2D<float> grid(0.0f, 100.0f, 1.0f,  // x: [0,100] step 1
+ *                         0.0f, 100.0f, 1.0f); // y: [0,100] step 1
+ *
+ * // Insert points
+ * grid.insert(10.5f, 20.3f, 0);
+ * grid.insert(10.8f, 20.7f, 1);
+ *
+ * // Query box
+ * auto indices = grid.query_box(10.0f, 11.0f, 20.0f, 21.0f);
+ * @endcode
+ */
+template<typename T, typename Payload = void>
+class GridIndex2D {
+public:
+    /** @brief Payload type; GridNoPayload when Payload is void */
+    typedef typename GridPayloadCells<Payload>::value_type payload_type;
+
+    /**
+     * @brief Construct a new Grid Index 2D object
+     *
+     * @param x_start Minimum x coordinate of the grid
+     * @param x_end Maximum x coordinate of the grid
+     * @param x_step Cell width in x direction
+     * @param y_start Minimum y coordinate of the grid
+     * @param y_end Maximum y coordinate of the grid
+     * @param y_step Cell height in y direction
+     *
+     * @throws std::invalid_argument if step values are <= 0 or if start >= end
+     */
+    GridIndex2D(T x_start, T x_end, T x_step,
+                T y_start, T y_end, T y_step)
+        : x_start_(x_start), x_end_(x_end), x_step_(x_step),
+          y_start_(y_start), y_end_(y_end), y_step_(y_step)
+    {
+        if (x_step <= 0 || y_step <= 0) {
+            throw std::invalid_argument("Step values must be positive");
+        }
+        if (x_start >= x_end || y_start >= y_end) {
+            throw std::invalid_argument("Start must be less than end");
+        }
+
+        // Calculate number of cells in each dimension
+        x_axis_ = GridAxisMath<T>::make_axis(x_start, x_end, x_step);
+        y_axis_ = GridAxisMath<T>::make_axis(y_start, y_end, y_step);
+        nx_ = x_axis_.n;
+        ny_ = y_axis_.n;
+
+        // Allocate grid cells
+        grid_.resize(nx_ * ny_);
+        payloads_.resize(grid_.size());
+        num_points_ = 0;
+        cells_sorted_ = true;
+        cells_key_sorted_ = false;
+        version_ = 0;
+    }
+
+    /**
+     * @brief Construct a Grid Index 2D with exact per-cell capacities
+     *
+     * @param cell_counts Number of points each cell will receive, indexed by
+     *        linear cell id (j * nx + i), e.g. get_cell_counts() of an index
+     *        built from the same geometry in a previous run
+     *
+     * Subsequent insert() calls fill the preallocated slots without any
+     * reallocation, so an incremental build costs the same as a counting
+     * sort. Inserting more points than announced into a cell is allowed and
+     * falls back to normal vector growth for that cell.
+     *
+     * @throws std::invalid_argument on invalid grid parameters or if
+     *         cell_counts.size() does not match the number of cells
+     */
+    GridIndex2D(T x_start, T x_end, T x_step,
+                T y_start, T y_end, T y_step,
+                const std::vector<size_t>& cell_counts)
+        : GridIndex2D(x_start, x_end, x_step, y_start, y_end, y_step)
+    {
+        reserve_cells(cell_counts);
+    }
+
+    /**
+     * @brief Insert a point index into the grid
+     *
+     * @param x X coordinate of the point
+     * @param y Y coordinate of the point
+     * @param index Index of the point in your data structure
+     *
+     * Points outside the grid bounds are clamped to the nearest edge cell.
+     */
+    void insert(T x, T y, size_t index) {
+        static_assert(std::is_void<Payload>::value, "Grids with a Payload need insert(x, y, index, payload)");
+        insert(x, y, index, payload_type());
+    }
+
+    /**
+     * @brief Insert a point index with its payload
+     *
+     * @param payload Stored next to the index and handed to query_box_payload()
+     */
+    void insert(T x, T y, size_t index, const payload_type& payload) {
+        int i = get_cell_x(x);
+        int j = get_cell_y(y);
+        int cell_id = get_cell_id(i, j);
+        std::vector<size_t>& cell = grid_[cell_id];
+        if (!cell.empty() && index < cell.back()) cells_sorted_ = false;
+        cell.push_back(index);
+        payloads_.push(cell_id, payload);
+        ++num_points_;
+        cells_key_sorted_ = false;
+        ++version_;
+    }
+
+    /**
+     * @brief Insert an array of points with exact per-cell allocation
+     *
+     * @param xs X coordinates of n points
+     * @param ys Y coordinates of n points
+     * @param n Number of points
+     * @param first_index Index stored for xs[0]; point k gets first_index + k
+     *
+     * Counting-sort build: cell ids are computed once, counted, every cell
+     * is grown in a single allocation (to its exact size if it was empty,
+     * else at least doubled), then indices are appended. Equivalent to
+     * calling insert() for k = 0..n-1 in order, so cells stay sorted by
+     * index. Needs 4 bytes of temporary memory per point.
+     */
+    void insert_points(const T* xs, const T* ys, size_t n, size_t first_index = 0) {
+        static_assert(std::is_void<Payload>::value,
+                      "Grids with a Payload need insert_points(xs, ys, payloads, n)");
+        insert_cells(xs, ys, nullptr, n, first_index);
+    }
+
+    /**
+     * @brief Insert an array of points with their payloads
+     *
+     * @param payloads n payloads; point k gets payloads[k] (ignored without Payload)
+     *
+     * Same counting-sort build as insert_points(xs, ys, n, first_index),
+     * with the payloads laid out in cell order next to the indices.
+     *
+     * @throws std::invalid_argument if payloads is null for a grid with a
+     *         Payload and n > 0
+     */
+    void insert_points(const T* xs, const T* ys, const payload_type* payloads, size_t n,
+                       size_t first_index = 0) {
+        if (!std::is_void<Payload>::value && n > 0 && !payloads) {
+            throw std::invalid_argument("payloads must not be null for a grid with a Payload");
+        }
+        insert_cells(xs, ys, payloads, n, first_index);
+    }
+
+    /**
+     * @brief Query all point indices within a rectangular box
+     *
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     * @return std::vector<size_t> Vector of all point indices in the box
+     *
+     * Edge inclusion examples:
+     * - [x1, x2] × [y1, y2]: both true (default, fully inclusive)
+     * - (x1, x2) × (y1, y2): both false (fully exclusive)
+     * - [x1, x2) × [y1, y2): include_min=true, include_max=false (half-open)
+     *
+     * Note: Returns all points in grid cells that intersect with the query box.
+     * This may include points outside the exact box boundaries (false positives).
+     * For exact results, filter the returned indices against actual point coordinates.
+     *
+     * Complexity: O(k * m) where k is the number of cells in the box
+     * and m is the average number of points per cell.
+     */
+    std::vector<size_t> query_box(T x1, T x2, T y1, T y2,
+                                   bool include_min = true, bool include_max = true) const {
+        switch (grid_edges(include_min, include_max)) {
+        case Edges::Exclusive: return query_box<Edges::Exclusive>(x1, x2, y1, y2);
+        case Edges::HalfOpen: return query_box<Edges::HalfOpen>(x1, x2, y1, y2);
+        case Edges::ReverseHalfOpen: return query_box<Edges::ReverseHalfOpen>(x1, x2, y1, y2);
+        default: return query_box<Edges::Inclusive>(x1, x2, y1, y2);
+        }
+    }
+
+    /**
+     * @brief Query all point indices within a rectangular box, edge mode fixed at compile time
+     *
+     * @tparam E Edge mode, e.g. query_box<Edges::HalfOpen>(x1, x2, y1, y2)
+     */
+    template<Edges E>
+    std::vector<size_t> query_box(T x1, T x2, T y1, T y2) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX);)
+        std::vector<size_t> result;
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+
+        // Get cell ranges
+        int i_min, i_max, j_min, j_max;
+        get_cell_range<E>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+
+        // Collect indices from all cells in range
+        for (int j = j_min; j <= j_max; ++j) {
+            for (int i = i_min; i <= i_max; ++i) {
+                prefetch_scan(i, j, i_min, i_max, j_max);
+                int cell_id = get_cell_id(i, j);
+                const auto& cell = grid_[cell_id];
+                GRID_INDEX_STATS(stats.cell(cell.size());)
+                result.insert(result.end(), cell.begin(), cell.end());
+            }
+        }
+
+        GRID_INDEX_STATS(stats.emit(result.size());)
+        return result;
+    }
+
+    /**
+     * @brief Query all point indices within a rectangular box (no allocation version)
+     *
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param result Reference to vector to store results (will be cleared before use)
+     * @param append_results If true, append to existing results instead of clearing
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     *
+     * This version allows you to reuse the same result vector across multiple queries,
+     * avoiding repeated allocations. The result vector is cleared at the start.
+     *
+     * Example:
+     * @code
+     * std::vector<size_t> result;
+     * result.reserve(1000);  // Pre-allocate once
+     *
+     * // Reuse the same vector for multiple queries
+     * grid.query_box_no_alloc(0, 10, 0, 10, result);
+     * // process result...
+     *
+     * grid.query_box_no_alloc(20, 30, 20, 30, result);
+     * // process result...
+     * @endcode
+     *
+     * Note: Returns all points in grid cells that intersect with the query box.
+     * This may include points outside the exact box boundaries (false positives).
+     * For exact results, filter the returned indices against actual point coordinates.
+     *
+     * Complexity: O(k * m) where k is the number of cells in the box
+     * and m is the average number of points per cell.
+     */
+    void query_box_no_alloc(T x1, T x2, T y1, T y2, std::vector<size_t>& result,
+                            bool append_results = false,
+                            bool include_min = true, bool include_max = true) const {
+        switch (grid_edges(include_min, include_max)) {
+        case Edges::Exclusive:
+            query_box_no_alloc<Edges::Exclusive>(x1, x2, y1, y2, result, append_results);
+            break;
+        case Edges::HalfOpen:
+            query_box_no_alloc<Edges::HalfOpen>(x1, x2, y1, y2, result, append_results);
+            break;
+        case Edges::ReverseHalfOpen:
+            query_box_no_alloc<Edges::ReverseHalfOpen>(x1, x2, y1, y2, result, append_results);
+            break;
+        default:
+            query_box_no_alloc<Edges::Inclusive>(x1, x2, y1, y2, result, append_results);
+            break;
+        }
+    }
+
+    /**
+     * @brief No-allocation box query with the edge mode fixed at compile time
+     *
+     * @tparam E Edge mode, e.g. query_box_no_alloc<Edges::HalfOpen>(x1, x2, y1, y2, result)
+     */
+    template<Edges E>
+    void query_box_no_alloc(T x1, T x2, T y1, T y2, std::vector<size_t>& result,
+                            bool append_results = false) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_NO_ALLOC);)
+        if(!append_results)
+            result.clear();
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        GRID_INDEX_STATS(const size_t initial_size = result.size();)
+
+        // Get cell ranges
+        int i_min, i_max, j_min, j_max;
+        get_cell_range<E>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+
+        // Collect indices from all cells in range
+        for (int j = j_min; j <= j_max; ++j) {
+            for (int i = i_min; i <= i_max; ++i) {
+                prefetch_scan(i, j, i_min, i_max, j_max);
+                int cell_id = get_cell_id(i, j);
+                const auto& cell = grid_[cell_id];
+                GRID_INDEX_STATS(stats.cell(cell.size());)
+                result.insert(result.end(), cell.begin(), cell.end());
+            }
+        }
+
+        GRID_INDEX_STATS(stats.emit(result.size() - initial_size);)
+    }
+
+    /**
+     * @brief Query all point indices within a box using a callback
+     *
+     * @tparam Callback Function or lambda type: void(size_t index)
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param callback Function called for each point index in the box
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     *
+     * More efficient than query_box() when you don't need to store results.
+     * A callback returning Visit instead of void ends the query as soon as it
+     * returns Visit::Stop.
+     *
+     * Example:
+     * @code
+     * grid.query_box_callback(0, 10, 0, 10, [&](size_t idx) {
+     *     std::cout << "Found point: " << idx << std::endl;
+     * });
+     *
+     * grid.query_box_callback(0, 10, 0, 10, [&](size_t idx) {
+     *     return is_match(idx) ? Visit::Stop : Visit::Continue;
+     * });
+     * @endcode
+     */
+    template<typename Callback>
+    void query_box_callback(T x1, T x2, T y1, T y2, Callback callback,
+                           bool include_min = true, bool include_max = true) const {
+        switch (grid_edges(include_min, include_max)) {
+        case Edges::Exclusive:
+            query_box_callback<Edges::Exclusive>(x1, x2, y1, y2, callback);
+            break;
+        case Edges::HalfOpen:
+            query_box_callback<Edges::HalfOpen>(x1, x2, y1, y2, callback);
+            break;
+        case Edges::ReverseHalfOpen:
+            query_box_callback<Edges::ReverseHalfOpen>(x1, x2, y1, y2, callback);
+            break;
+        default:
+            query_box_callback<Edges::Inclusive>(x1, x2, y1, y2, callback);
+            break;
+        }
+    }
+
+    /**
+     * @brief Callback box query with the edge mode fixed at compile time
+     *
+     * @tparam E Edge mode, e.g. query_box_callback<Edges::HalfOpen>(x1, x2, y1, y2, fn)
+     */
+    template<Edges E, typename Callback>
+    void query_box_callback(T x1, T x2, T y1, T y2, Callback callback) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_CALLBACK);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+
+        // Get cell ranges
+        int i_min, i_max, j_min, j_max;
+        get_cell_range<E>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+
+        // Call callback for each index in range
+        for (int j = j_min; j <= j_max; ++j) {
+            for (int i = i_min; i <= i_max; ++i) {
+                prefetch_scan(i, j, i_min, i_max, j_max);
+                int cell_id = get_cell_id(i, j);
+                const auto& cell = grid_[cell_id];
+                GRID_INDEX_STATS(stats.cell(cell.size());)
+                for (size_t k = 0; k < cell.size(); ++k) {
+                    if (!grid_visit(callback, cell[k])) {
+                        GRID_INDEX_STATS(stats.emit(k + 1);)
+                        return;
+                    }
+                }
+                GRID_INDEX_STATS(stats.emit(cell.size());)
+            }
+        }
+    }
+
+    /**
+     * @brief Visit the index and payload of every point in the cells of a box
+     *
+     * @tparam Callback Function or lambda type: void(size_t index, const Payload& payload),
+     *         or returning Visit to end the query early
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param callback Function called for each point in the box
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     *
+     * Visits the indices of query_box_callback(), in the same order. Each
+     * cell's payloads sit next to its indices in cell order, so the scan
+     * streams two contiguous arrays. Gathering attributes by index from a
+     * separate array would instead cost a cache miss per point on large
+     * data. Filter on the payload in the callback.
+     *
+     * Example:
+     * @code
+     * struct Trace { float offset; float azimuth; };
+     * GridIndex2D<double, Trace> grid(...);
+     * grid.query_box_payload(x1, x2, y1, y2, [&](size_t idx, const Trace& t) {
+     *     if (t.offset >= 500.0f && t.offset < 1500.0f) selected.push_back(idx);
+     * });
+     * @endcode
+     */
+    template<typename Callback>
+    void query_box_payload(T x1, T x2, T y1, T y2, Callback callback,
+                           bool include_min = true, bool include_max = true) const {
+        static_assert(!std::is_void<Payload>::value, "query_box_payload() needs a Payload type");
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_PAYLOAD);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+
+        int i_min, i_max, j_min, j_max;
+        get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max, include_min, include_max);
+
+        for (int j = j_min; j <= j_max; ++j) {
+            for (int i = i_min; i <= i_max; ++i) {
+                prefetch_scan(i, j, i_min, i_max, j_max, true);
+                const int cell_id = get_cell_id(i, j);
+                const auto& cell = grid_[cell_id];
+                const payload_type* payload = payloads_.data(cell_id);
+                GRID_INDEX_STATS(stats.cell(cell.size());)
+                for (size_t k = 0; k < cell.size(); ++k) {
+                    if (!grid_visit(callback, cell[k], payload[k])) {
+                        GRID_INDEX_STATS(stats.emit(k + 1);)
+                        return;
+                    }
+                }
+                GRID_INDEX_STATS(stats.emit(cell.size());)
+            }
+        }
+    }
+
+    /**
+     * @brief Query the indices in a box whose payload attribute lies in a range
+     *
+     * @tparam Getter Data member pointer (&Trace::offset) or function A(const Payload&)
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param get Attribute to test
+     * @param lo Lowest accepted value
+     * @param hi Highest accepted value; lo > hi selects the wrapped range,
+     *        see grid_in_range()
+     * @param result Receives the matching indices in query_box() order (cleared first)
+     * @param summary Optional per-cell bounds of the same attribute from summarize()
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     * @return Number of indices written to result
+     *
+     * The predicate runs inside the scan over each cell's indices and
+     * payloads, so filtering costs one sequential pass instead of a query
+     * followed by a gather of the attribute by index. With a summary,
+     * cells whose bounds miss the range are skipped without reading them,
+     * and cells entirely inside it are copied without testing each point.
+     * Skipped cells count as empty cells in the query stats.
+     *
+     * @throws std::invalid_argument if summary was built before the last
+     *         insert or clear, or for a grid of another size
+     */
+    template<typename Getter>
+    size_t query_box_where(T x1, T x2, T y1, T y2, Getter get,
+                           typename GridAttributeType<Getter, payload_type>::type lo,
+                           typename GridAttributeType<Getter, payload_type>::type hi,
+                           std::vector<size_t>& result,
+                           const GridAttributeSummary<
+                               typename GridAttributeType<Getter, payload_type>::type>* summary = nullptr,
+                           bool include_min = true, bool include_max = true) const {
+        static_assert(!std::is_void<Payload>::value, "query_box_where() needs a Payload type");
+        if (summary && (summary->version_ != version_ || summary->cells_.size() != grid_.size())) {
+            throw std::invalid_argument("Attribute summary is out of date; call summarize() again");
+        }
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_WHERE);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        result.clear();
+
+        int i_min, i_max, j_min, j_max;
+        get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max, include_min, include_max);
+
+        for (int j = j_min; j <= j_max; ++j) {
+            for (int i = i_min; i <= i_max; ++i) {
+                prefetch_scan(i, j, i_min, i_max, j_max, true);
+                const int cell_id = get_cell_id(i, j);
+                const auto& cell = grid_[cell_id];
+                if (summary && !cell.empty()) {
+                    const auto& bounds = summary->cells_[cell_id];
+                    if (!bounds.may_match(lo, hi)) {
+                        GRID_INDEX_STATS(stats.cell(0);)
+                        continue;
+                    }
+                    if (bounds.all_match(lo, hi)) {
+                        GRID_INDEX_STATS(stats.cell(cell.size());)
+                        result.insert(result.end(), cell.begin(), cell.end());
+                        continue;
+                    }
+                }
+                GRID_INDEX_STATS(stats.cell(cell.size());)
+                // Branch-free compaction: write every index, advance on a match
+                const payload_type* payload = payloads_.data(cell_id);
+                size_t n = result.size();
+                result.resize(n + cell.size());
+                for (size_t k = 0; k < cell.size(); ++k) {
+                    result[n] = cell[k];
+                    n += grid_in_range<typename GridAttributeType<Getter, payload_type>::type>(
+                        grid_attribute(get, payload[k]), lo, hi) ? 1 : 0;
+                }
+                result.resize(n);
+            }
+        }
+        GRID_INDEX_STATS(stats.emit(result.size());)
+        return result.size();
+    }
+
+    /**
+     * @brief Build per-cell bounds of a payload attribute for query_box_where()
+     *
+     * @param get Data member pointer (&Trace::offset) or function A(const Payload&)
+     *
+     * Bounds pay off when the attribute is spatially coherent (depth,
+     * line number, acquisition time), so that whole cells fall outside or
+     * inside typical ranges. Rebuild after inserting or clearing.
+     *
+     * Complexity: O(number of cells + number of points).
+     */
+    template<typename Getter>
+    GridAttributeSummary<typename GridAttributeType<Getter, payload_type>::type>
+    summarize(Getter get) const {
+        static_assert(!std::is_void<Payload>::value, "summarize() needs a Payload type");
+        typedef typename GridAttributeType<Getter, payload_type>::type A;
+        GridAttributeSummary<A> summary;
+        summary.version_ = version_;
+        summary.cells_.resize(grid_.size());
+        for (size_t c = 0; c < grid_.size(); ++c) {
+            GridCellBounds<A>& bounds = summary.cells_[c];
+            bounds.min = std::numeric_limits<A>::max();
+            bounds.max = std::numeric_limits<A>::lowest();
+            const payload_type* payload = payloads_.data(c);
+            for (size_t k = 0; k < grid_[c].size(); ++k) {
+                const A& a = grid_attribute(get, payload[k]);
+                if (a < bounds.min) bounds.min = a;
+                if (bounds.max < a) bounds.max = a;
+            }
+        }
+        return summary;
+    }
+
+    /**
+     * @brief Query the indices of a box whose key lies in a range, by binary search per cell
+     *
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param get The key passed to sort_cells_by_key()
+     * @param lo Lowest accepted key
+     * @param hi Highest accepted key; lo > hi selects the wrapped range,
+     *        see grid_in_range()
+     * @param result Receives the matching indices, cell by cell in key order (cleared first)
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     * @return Number of indices written to result
      *
-     * @param x_start Minimum x coordinate of the grid
-     * @param x_end Maximum x coordinate of the grid
-     * @param x_step Cell width in x direction
-     * @param y_start Minimum y coordinate of the grid
-     * @param y_end Maximum y coordinate of the grid
-     * @param y_step Cell height in y direction
+     * Selects the same indices as query_box_where() with the same key and
+     * range. Cells sorted by the key hold each range as one contiguous run
+     * (two for a wrapped range), located with O(log m) key reads, and the
+     * run's indices are copied without testing them. The cost then
+     * depends on the points returned, not on the points in the box.
      *
-     * @throws std::invalid_argument if step values are <= 0 or if start >= end
+     * @throws std::invalid_argument if cells_key_sorted() is false
      */
-    GridIndex2D(T x_start, T x_end, T x_step,
-                T y_start, T y_end, T y_step)
-        : x_start_(x_start), x_end_(x_end), x_step_(x_step),
-          y_start_(y_start), y_end_(y_end), y_step_(y_step)
-    {
-        if (x_step <= 0 || y_step <= 0) {
-            throw std::invalid_argument("Step values must be positive");
-        }
-        if (x_start >= x_end || y_start >= y_end) {
-            throw std::invalid_argument("Start must be less than end");
+    template<typename Getter>
+    size_t query_box_key_range(T x1, T x2, T y1, T y2, Getter get,
+                               typename GridAttributeType<Getter, payload_type>::type lo,
+                               typename GridAttributeType<Getter, payload_type>::type hi,
+                               std::vector<size_t>& result,
+                               bool include_min = true, bool include_max = true) const {
+        static_assert(!std::is_void<Payload>::value, "query_box_key_range() needs a Payload type");
+        typedef typename GridAttributeType<Getter, payload_type>::type A;
+        if (!cells_key_sorted_) {
+            throw std::invalid_argument("Cells are not sorted by key; call sort_cells_by_key() first");
         }
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_KEY_RANGE);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        result.clear();
 
-        // Calculate number of cells in each dimension
-        nx_ = static_cast<int>(std::ceil((x_end - x_start) / x_step));
-        ny_ = static_cast<int>(std::ceil((y_end - y_start) / y_step));
+        int i_min, i_max, j_min, j_max;
+        get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max, include_min, include_max);
 
-        // Allocate grid cells
-        grid_.resize(nx_ * ny_);
+        const auto key_below = [&](const payload_type& p, const A& key) {
+            return grid_attribute(get, p) < key;
+        };
+        const auto key_above = [&](const A& key, const payload_type& p) {
+            return key < grid_attribute(get, p);
+        };
+        for (int j = j_min; j <= j_max; ++j) {
+            for (int i = i_min; i <= i_max; ++i) {
+                prefetch_scan(i, j, i_min, i_max, j_max, true);
+                const int cell_id = get_cell_id(i, j);
+                const auto& cell = grid_[cell_id];
+                GRID_INDEX_STATS(stats.cell(cell.size());)
+                if (cell.empty()) continue;
+                const payload_type* begin = payloads_.data(cell_id);
+                const payload_type* end = begin + cell.size();
+                if (!(hi < lo)) {
+                    const payload_type* first = std::lower_bound(begin, end, lo, key_below);
+                    const payload_type* last = std::upper_bound(first, end, hi, key_above);
+                    result.insert(result.end(), cell.begin() + (first - begin),
+                                  cell.begin() + (last - begin));
+                } else {
+                    // Wrapped: the head up to hi, then the tail from lo
+                    const payload_type* head = std::upper_bound(begin, end, hi, key_above);
+                    const payload_type* tail = std::lower_bound(head, end, lo, key_below);
+                    result.insert(result.end(), cell.begin(), cell.begin() + (head - begin));
+                    result.insert(result.end(), cell.begin() + (tail - begin), cell.end());
+                }
+            }
+        }
+        GRID_INDEX_STATS(stats.emit(result.size());)
+        return result.size();
     }
 
     /**
-     * @brief Insert a point index into the grid
+     * @brief Check whether any point index lies in the cells of a box
      *
-     * @param x X coordinate of the point
-     * @param y Y coordinate of the point
-     * @param index Index of the point in your data structure
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param order Cell visiting order; CenterOut finds points near the
+     *        middle of large boxes after fewer cells
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     * @return true if query_box() would return at least one index
      *
-     * Points outside the grid bounds are clamped to the nearest edge cell.
+     * Stops at the first non-empty cell and reads no indices.
      */
-    void insert(T x, T y, size_t index) {
-        int i = get_cell_x(x);
-        int j = get_cell_y(y);
-        int cell_id = get_cell_id(i, j);
-        grid_[cell_id].push_back(index);
+    bool exists_in_box(T x1, T x2, T y1, T y2, CellOrder order = CellOrder::RowMajor,
+                       bool include_min = true, bool include_max = true) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_EXISTS);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+
+        int i_min, i_max, j_min, j_max;
+        get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max,
+                       include_min, include_max);
+
+        bool found = false;
+        visit_cells(i_min, i_max, j_min, j_max, order, [&](const std::vector<size_t>& cell) {
+            GRID_INDEX_STATS(stats.cell(cell.size());)
+            found = !cell.empty();
+            return !found;
+        });
+        return found;
     }
 
     /**
-     * @brief Query all point indices within a rectangular box
+     * @brief Query at most limit point indices of a box, optionally skipping some
      *
      * @param x1 Minimum x coordinate of the query box
      * @param x2 Maximum x coordinate of the query box
      * @param y1 Minimum y coordinate of the query box
      * @param y2 Maximum y coordinate of the query box
+     * @param result Receives the indices (cleared first)
+     * @param limit Maximum number of indices to return
+     * @param offset Number of leading indices to skip, in visiting order
+     * @param order Cell visiting order (RowMajor gives query_box() order)
      * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
      * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
-     * @return std::vector<size_t> Vector of all point indices in the box
+     * @return Number of indices written to result
      *
-     * Edge inclusion examples:
-     * - [x1, x2] × [y1, y2]: both true (default, fully inclusive)
-     * - (x1, x2) × (y1, y2): both false (fully exclusive)
-     * - [x1, x2) × [y1, y2): include_min=true, include_max=false (half-open)
+     * Stops visiting cells once limit indices are collected; skipped
+     * cells are passed over by size without reading their indices.
+     * Calling with offset = 0, limit, then offset = limit, ... pages
+     * through the same sequence as long as the grid is not modified.
+     */
+    size_t query_box_limit(T x1, T x2, T y1, T y2, std::vector<size_t>& result,
+                           size_t limit, size_t offset = 0,
+                           CellOrder order = CellOrder::RowMajor,
+                           bool include_min = true, bool include_max = true) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_LIMIT);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        result.clear();
+        if (limit == 0) return 0;
+
+        int i_min, i_max, j_min, j_max;
+        get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max,
+                       include_min, include_max);
+
+        size_t skip = offset;
+        visit_cells(i_min, i_max, j_min, j_max, order, [&](const std::vector<size_t>& cell) {
+            GRID_INDEX_STATS(stats.cell(cell.size());)
+            if (skip >= cell.size()) {
+                skip -= cell.size();
+                return true;
+            }
+            const size_t take = std::min(cell.size() - skip, limit - result.size());
+            result.insert(result.end(), cell.begin() + skip, cell.begin() + skip + take);
+            skip = 0;
+            return result.size() < limit;
+        });
+
+        GRID_INDEX_STATS(stats.emit(result.size());)
+        return result.size();
+    }
+
+    /**
+     * @brief Query all point indices within a box, in ascending order
      *
-     * Note: Returns all points in grid cells that intersect with the query box.
-     * This may include points outside the exact box boundaries (false positives).
-     * For exact results, filter the returned indices against actual point coordinates.
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param result Reference to vector to store results (cleared first)
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
      *
-     * Complexity: O(k * m) where k is the number of cells in the box
-     * and m is the average number of points per cell.
+     * Returns the indices of query_box() sorted ascending, e.g. to turn
+     * trace reads into sequential I/O. While cells_sorted() holds, the
+     * per-cell lists are merged instead of sorted: cells whose index
+     * ranges do not overlap are concatenated, the rest are k-way merged
+     * with a heap, O(n log k) for n indices from k overlapping cells.
+     * Otherwise, or for boxes spanning many overlapping cells, the result
+     * is collected and sorted.
      */
-    std::vector<size_t> query_box(T x1, T x2, T y1, T y2,
-                                   bool include_min = true, bool include_max = true) const {
-        std::vector<size_t> result;
+    void query_box_sorted(T x1, T x2, T y1, T y2, std::vector<size_t>& result,
+                          bool include_min = true, bool include_max = true) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_SORTED);)
+        result.clear();
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
 
-        // Get cell ranges
         int i_min, i_max, j_min, j_max;
         get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max,
-                      include_min, include_max);
+                       include_min, include_max);
 
-        // Collect indices from all cells in range
+        // Non-empty cell lists, reused across queries of this thread
+        static thread_local std::vector<IndexSpan> spans;
+        spans.clear();
+        size_t total = 0;
         for (int j = j_min; j <= j_max; ++j) {
             for (int i = i_min; i <= i_max; ++i) {
-                int cell_id = get_cell_id(i, j);
-                const auto& cell = grid_[cell_id];
-                result.insert(result.end(), cell.begin(), cell.end());
+                prefetch_scan(i, j, i_min, i_max, j_max);
+                const auto& cell = grid_[get_cell_id(i, j)];
+                GRID_INDEX_STATS(stats.cell(cell.size());)
+                if (cell.empty()) continue;
+                IndexSpan span = {cell.data(), cell.data() + cell.size()};
+                spans.push_back(span);
+                total += cell.size();
             }
         }
+        result.reserve(total);
+        GRID_INDEX_STATS(stats.emit(total);)
 
+        if (!cells_sorted_) {
+            for (size_t k = 0; k < spans.size(); ++k) {
+                result.insert(result.end(), spans[k].begin, spans[k].end);
+            }
+            std::sort(result.begin(), result.end());
+            return;
+        }
+        merge_sorted_spans(spans, result);
+    }
+
+    /**
+     * @brief Query all point indices within a box, in ascending order
+     * @return std::vector<size_t> The indices of query_box(), sorted
+     */
+    std::vector<size_t> query_box_sorted(T x1, T x2, T y1, T y2,
+                                         bool include_min = true, bool include_max = true) const {
+        std::vector<size_t> result;
+        query_box_sorted(x1, x2, y1, y2, result, include_min, include_max);
         return result;
     }
 
     /**
-     * @brief Query all point indices within a rectangular box (no allocation version)
+     * @brief Query the k point indices of a box closest to a centre
      *
      * @param x1 Minimum x coordinate of the query box
      * @param x2 Maximum x coordinate of the query box
      * @param y1 Minimum y coordinate of the query box
      * @param y2 Maximum y coordinate of the query box
-     * @param result Reference to vector to store results (will be cleared before use)
-     * @param append_results If true, append to existing results instead of clearing
+     * @param cx X coordinate of the centre
+     * @param cy Y coordinate of the centre
+     * @param xs X coordinates of the indexed points, xs[index]
+     * @param ys Y coordinates of the indexed points, ys[index]
+     * @param k Maximum number of indices to return
+     * @param result Receives the indices, nearest first (cleared first)
      * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
      * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     * @return Number of indices written to result
      *
-     * This version allows you to reuse the same result vector across multiple queries,
-     * avoiding repeated allocations. The result vector is cleared at the start.
-     *
-     * Example:
-     * @code
-     * std::vector<size_t> result;
-     * result.reserve(1000);  // Pre-allocate once
-     *
-     * // Reuse the same vector for multiple queries
-     * grid.query_box_no_alloc(0, 10, 0, 10, result);
-     * // process result...
-     *
-     * grid.query_box_no_alloc(20, 30, 20, 30, result);
-     * // process result...
-     * @endcode
-     *
-     * Note: Returns all points in grid cells that intersect with the query box.
-     * This may include points outside the exact box boundaries (false positives).
-     * For exact results, filter the returned indices against actual point coordinates.
-     *
-     * Complexity: O(k * m) where k is the number of cells in the box
-     * and m is the average number of points per cell.
+     * Candidates are the points inside the box: boundary cells also hold
+     * points beyond it, so every point is tested against the box and its
+     * edge flags. The grid keeps no coordinates, so the box test and the
+     * distances read xs/ys. Non-empty cells are
+     * visited by increasing minimum distance to the centre, and the
+     * search stops at the first cell farther away than the current k-th
+     * nearest point. Equal distances are ordered by index.
      */
-    void query_box_no_alloc(T x1, T x2, T y1, T y2, std::vector<size_t>& result,
-                            bool append_results = false,
-                            bool include_min = true, bool include_max = true) const {
-        if(!append_results)
-            result.clear();
+    size_t query_box_nearest(T x1, T x2, T y1, T y2, T cx, T cy,
+                             const T* xs, const T* ys, size_t k,
+                             std::vector<size_t>& result,
+                             bool include_min = true, bool include_max = true) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_NEAREST);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        result.clear();
+        if (k == 0) return 0;
 
-        // Get cell ranges
         int i_min, i_max, j_min, j_max;
         get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max,
-                      include_min, include_max);
+                       include_min, include_max);
 
-        // Collect indices from all cells in range
+        const double c_x = static_cast<double>(cx);
+        const double c_y = static_cast<double>(cy);
+        // Squared gap of every column, reused across queries of this thread
+        static thread_local std::vector<double> gap_x;
+        gap_x.clear();
+        for (int i = i_min; i <= i_max; ++i) {
+            const double g = cell_gap(i, nx_, c_x, x_axis_);
+            gap_x.push_back(g * g);
+        }
+
+        static thread_local std::vector<CellDistance> cells;
+        cells.clear();
         for (int j = j_min; j <= j_max; ++j) {
+            const double g = cell_gap(j, ny_, c_y, y_axis_);
             for (int i = i_min; i <= i_max; ++i) {
-                int cell_id = get_cell_id(i, j);
-                const auto& cell = grid_[cell_id];
-                result.insert(result.end(), cell.begin(), cell.end());
+                const int id = get_cell_id(i, j);
+                if (grid_[id].empty()) {
+                    GRID_INDEX_STATS(stats.cell(0);)
+                    continue;
+                }
+                CellDistance c = {gap_x[i - i_min] + g * g, id};
+                cells.push_back(c);
+            }
+        }
+
+        // Cells: min-heap on distance. best: max-heap of the k nearest so far
+        auto farther = [](const CellDistance& a, const CellDistance& b) { return a.d2 > b.d2; };
+        auto nearer = [](const PointDistance& a, const PointDistance& b) {
+            return a.d2 < b.d2 || (a.d2 == b.d2 && a.index < b.index);
+        };
+        std::make_heap(cells.begin(), cells.end(), farther);
+        static thread_local std::vector<PointDistance> best;
+        best.clear();
+
+        for (size_t remaining = cells.size(); remaining > 0; --remaining) {
+            if (best.size() == k && cells.front().d2 > best.front().d2) break;
+            std::pop_heap(cells.begin(), cells.begin() + remaining, farther);
+            const auto& cell = grid_[cells[remaining - 1].cell];
+            // The next cell to visit is the new heap top
+            if (remaining > 1) grid_prefetch(grid_[cells.front().cell].data());
+            GRID_INDEX_STATS(stats.cell(cell.size());)
+            for (size_t idx : cell) {
+                const T px = xs[idx], py = ys[idx];
+                if (include_min ? (px < x1 || py < y1) : (px <= x1 || py <= y1)) continue;
+                if (include_max ? (px > x2 || py > y2) : (px >= x2 || py >= y2)) continue;
+                const double dx = static_cast<double>(px) - c_x;
+                const double dy = static_cast<double>(py) - c_y;
+                const PointDistance p = {dx * dx + dy * dy, idx};
+                if (best.size() < k) {
+                    best.push_back(p);
+                    std::push_heap(best.begin(), best.end(), nearer);
+                } else if (nearer(p, best.front())) {
+                    std::pop_heap(best.begin(), best.end(), nearer);
+                    best.back() = p;
+                    std::push_heap(best.begin(), best.end(), nearer);
+                }
             }
         }
+
+        std::sort_heap(best.begin(), best.end(), nearer);
+        result.reserve(best.size());
+        for (size_t m = 0; m < best.size(); ++m) {
+            result.push_back(best[m].index);
+        }
+        GRID_INDEX_STATS(stats.emit(result.size());)
+        return result.size();
     }
 
     /**
-     * @brief Query all point indices within a box using a callback
+     * @brief Query the union of several boxes, each index at most once
+     *
+     * @param boxes Query boxes; they may overlap
+     * @param result Reference to vector to store results (cleared unless append_results)
+     * @param append_results If true, append to existing results instead of clearing
+     * @param include_min Include lower edges of every box (default: true)
+     * @param include_max Include upper edges of every box (default: true)
+     *
+     * Every box is reduced to its cell range, then each row of the grid
+     * merges the ranges covering it into disjoint intervals, so every cell
+     * of the union is visited exactly once and no sort/unique pass is
+     * needed. Indices come out row by row, in query_box() order for a
+     * single box. Cost: O(B log B) for B boxes, O(B) per row spanned,
+     * plus the indices of the union's cells.
+     */
+    void query_boxes_union(const std::vector<GridBox<T>>& boxes, std::vector<size_t>& result,
+                           bool append_results = false,
+                           bool include_min = true, bool include_max = true) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOXES_UNION);)
+        if (!append_results)
+            result.clear();
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        GRID_INDEX_STATS(const size_t initial_size = result.size();)
+
+        std::vector<CellRange> ranges;
+        ranges.reserve(boxes.size());
+        int j_lo = ny_, j_hi = -1;
+        for (size_t b = 0; b < boxes.size(); ++b) {
+            CellRange r;
+            get_cell_range(boxes[b].x1, boxes[b].x2, boxes[b].y1, boxes[b].y2,
+                           r.i_min, r.i_max, r.j_min, r.j_max, include_min, include_max);
+            if (r.i_min > r.i_max || r.j_min > r.j_max) continue;
+            ranges.push_back(r);
+            j_lo = std::min(j_lo, r.j_min);
+            j_hi = std::max(j_hi, r.j_max);
+        }
+        std::sort(ranges.begin(), ranges.end(),
+                  [](const CellRange& a, const CellRange& b) { return a.i_min < b.i_min; });
+
+        for (int j = j_lo; j <= j_hi; ++j) {
+            // Sweep the ranges covering row j in i_min order, merging overlaps
+            int run_min = 0, run_max = -1;
+            for (size_t r = 0; r <= ranges.size(); ++r) {
+                const bool last = r == ranges.size();
+                if (!last && (j < ranges[r].j_min || j > ranges[r].j_max)) continue;
+                if (last || ranges[r].i_min > run_max) {
+                    for (int i = run_min; i <= run_max; ++i) {
+                        prefetch_scan(i, j, run_min, run_max, j);
+                        const auto& cell = grid_[get_cell_id(i, j)];
+                        GRID_INDEX_STATS(stats.cell(cell.size());)
+                        result.insert(result.end(), cell.begin(), cell.end());
+                    }
+                    if (last) break;
+                    run_min = ranges[r].i_min;
+                    run_max = ranges[r].i_max;
+                } else {
+                    run_max = std::max(run_max, ranges[r].i_max);
+                }
+            }
+        }
+
+        GRID_INDEX_STATS(stats.emit(result.size() - initial_size);)
+    }
+
+    /**
+     * @brief Query the union of several boxes, each index at most once
+     * @return std::vector<size_t> Indices of all cells covered by any box
+     */
+    std::vector<size_t> query_boxes_union(const std::vector<GridBox<T>>& boxes,
+                                          bool include_min = true,
+                                          bool include_max = true) const {
+        std::vector<size_t> result;
+        query_boxes_union(boxes, result, false, include_min, include_max);
+        return result;
+    }
+
+    /**
+     * @brief Lazy forward range over the point indices of a box query
+     *
+     * Returned by query_box_range(). Iteration walks the cells of the query
+     * box row by row and yields the indices of each non-empty cell, in the
+     * same order as query_box(); nothing is allocated or copied. The range
+     * and its iterators borrow the grid's cell storage and are invalidated
+     * by any modification of the grid.
+     */
+    class BoxQueryRange {
+    public:
+        class const_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef size_t value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const size_t* pointer;
+            typedef const size_t& reference;
+
+            /** @brief End iterator */
+            const_iterator()
+                : cells_(nullptr), nx_(0), i_min_(0), i_max_(-1), j_max_(-1),
+                  i_(0), j_(0), pos_(nullptr), end_(nullptr) {}
+
+            reference operator*() const { return *pos_; }
+            pointer operator->() const { return pos_; }
+
+            const_iterator& operator++() {
+                if (++pos_ == end_) {
+                    ++i_;
+                    next_cell();
+                }
+                return *this;
+            }
+
+            const_iterator operator++(int) {
+                const_iterator previous(*this);
+                ++*this;
+                return previous;
+            }
+
+            // Positions are unique pointers into cell storage; the end
+            // iterator (and an exhausted one) holds nullptr
+            bool operator==(const const_iterator& other) const { return pos_ == other.pos_; }
+            bool operator!=(const const_iterator& other) const { return pos_ != other.pos_; }
+
+        private:
+            friend class BoxQueryRange;
+
+            const std::vector<size_t>* cells_;
+            int nx_, i_min_, i_max_, j_max_;
+            int i_, j_;  // Current cell
+            const size_t* pos_;
+            const size_t* end_;
+
+            const_iterator(const std::vector<size_t>* cells, int nx,
+                           int i_min, int i_max, int j_min, int j_max)
+                : cells_(cells), nx_(nx), i_min_(i_min), i_max_(i_max), j_max_(j_max),
+                  i_(i_min), j_(j_min), pos_(nullptr), end_(nullptr) {
+                if (i_min > i_max) j_ = j_max + 1;  // Empty cell range
+                next_cell();
+            }
+
+            /** @brief Move to the first non-empty cell at or after (i_, j_) */
+            void next_cell() {
+                GRID_INDEX_STATS(GridQueryStatsRecorder stats(0);)
+                for (; j_ <= j_max_; ++j_, i_ = i_min_) {
+                    for (; i_ <= i_max_; ++i_) {
+                        const std::vector<size_t>& cell = cells_[j_ * nx_ + i_];
+#if GRID_INDEX_PREFETCH_DISTANCE > 0
+                        if (i_ + GRID_INDEX_PREFETCH_DISTANCE <= i_max_) {
+                            const std::vector<size_t>& ahead =
+                                cells_[j_ * nx_ + i_ + GRID_INDEX_PREFETCH_DISTANCE];
+                            if (!ahead.empty()) grid_prefetch(ahead.data());
+                        }
+#endif
+                        GRID_INDEX_STATS(stats.cell(cell.size());)
+                        if (!cell.empty()) {
+                            pos_ = cell.data();
+                            end_ = pos_ + cell.size();
+                            return;
+                        }
+                    }
+                }
+                pos_ = end_ = nullptr;
+            }
+        };
+
+        typedef const_iterator iterator;
+
+        const_iterator begin() const { return begin_; }
+        const_iterator end() const { return const_iterator(); }
+        bool empty() const { return begin_ == end(); }
+
+    private:
+        friend class GridIndex2D;
+
+        const_iterator begin_;
+
+        BoxQueryRange(const std::vector<size_t>* cells, int nx,
+                      int i_min, int i_max, int j_min, int j_max)
+            : begin_(cells, nx, i_min, i_max, j_min, j_max) {}
+    };
+
+    /**
+     * @brief Query a box as a lazy range of point indices
      *
-     * @tparam Callback Function or lambda type: void(size_t index)
      * @param x1 Minimum x coordinate of the query box
      * @param x2 Maximum x coordinate of the query box
      * @param y1 Minimum y coordinate of the query box
      * @param y2 Maximum y coordinate of the query box
-     * @param callback Function called for each point index in the box
      * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
      * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     * @return BoxQueryRange Forward range over the same indices as query_box()
+     *
+     * Costs the same as query_box_callback() but leaves control with the
+     * caller: use range-for (break stops the scan) or standard algorithms.
+     *
+     * Example:
+     * @code
+     * for (size_t idx : grid.query_box_range(0, 10, 0, 10)) {
+     *     if (matches(idx)) break;
+     * }
+     * auto r = grid.query_box_range(0, 10, 0, 10);
+     * size_t n = std::count_if(r.begin(), r.end(), is_live);
+     * @endcode
+     *
+     * The work happens while the caller iterates, so range queries are not
+     * recorded in the latency histograms. The query stats count the range
+     * once and each cell as the iteration reaches it. Indices are not
+     * counted as emitted, since the caller decides how many it consumes.
+     */
+    BoxQueryRange query_box_range(T x1, T x2, T y1, T y2,
+                                  bool include_min = true, bool include_max = true) const {
+        switch (grid_edges(include_min, include_max)) {
+        case Edges::Exclusive: return query_box_range<Edges::Exclusive>(x1, x2, y1, y2);
+        case Edges::HalfOpen: return query_box_range<Edges::HalfOpen>(x1, x2, y1, y2);
+        case Edges::ReverseHalfOpen: return query_box_range<Edges::ReverseHalfOpen>(x1, x2, y1, y2);
+        default: return query_box_range<Edges::Inclusive>(x1, x2, y1, y2);
+        }
+    }
+
+    /**
+     * @brief Lazy box query with the edge mode fixed at compile time
+     *
+     * @tparam E Edge mode, e.g. query_box_range<Edges::HalfOpen>(x1, x2, y1, y2)
+     */
+    template<Edges E>
+    BoxQueryRange query_box_range(T x1, T x2, T y1, T y2) const {
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        int i_min, i_max, j_min, j_max;
+        get_cell_range<E>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+        return BoxQueryRange(grid_.data(), nx_, i_min, i_max, j_min, j_max);
+    }
+
+    /**
+     * @brief Clear all data from the grid
+     *
+     * @param release_memory If false (default), cells keep their capacity so
+     *        that refilling with a similar dataset does not reallocate. If
+     *        true, all per-cell storage is freed.
+     */
+    void clear(bool release_memory = false) {
+        for (auto& cell : grid_) {
+            if (release_memory) {
+                std::vector<size_t>().swap(cell);
+            } else {
+                cell.clear();
+            }
+        }
+        payloads_.clear(release_memory);
+        num_points_ = 0;
+        cells_sorted_ = true;
+        cells_key_sorted_ = false;
+        ++version_;
+    }
+
+    /**
+     * @brief Whether every cell holds its indices in ascending order
+     *
+     * True as long as indices were inserted in non-decreasing order per
+     * cell (e.g. insert(x[k], y[k], k) for k = 0, 1, ...), after clear()
+     * and after sort_cells(). query_box_sorted() relies on it.
+     */
+    bool cells_sorted() const {
+        return cells_sorted_;
+    }
+
+    /**
+     * @brief Sort the indices of every cell
+     *
+     * Restores cells_sorted() after out-of-order inserts so that
+     * query_box_sorted() can merge instead of sort. Payloads move with
+     * their indices. Undoes sort_cells_by_key() if it reorders anything.
+     *
+     * Complexity: O(n log m) for n points and m points per cell.
+     */
+    void sort_cells() {
+        if (cells_sorted_) return;
+        for (size_t c = 0; c < grid_.size(); ++c) {
+            if (!std::is_sorted(grid_[c].begin(), grid_[c].end())) {
+                payloads_.sort_cell(c, grid_[c]);
+            }
+        }
+        cells_sorted_ = true;
+        cells_key_sorted_ = false;
+    }
+
+    /**
+     * @brief Whether every cell is ordered by the key of the last sort_cells_by_key()
+     *
+     * Cleared by insert, clear() and sort_cells(); query_box_key_range()
+     * requires it.
+     */
+    bool cells_key_sorted() const {
+        return cells_key_sorted_;
+    }
+
+    /**
+     * @brief Sort every cell by a payload attribute, for query_box_key_range()
+     *
+     * @param get Data member pointer (&Trace::offset) or function A(const Payload&);
+     *        the key must be totally ordered by operator< (no NaN)
+     *
+     * Call once the grid is built ("frozen"): any later insert clears
+     * cells_key_sorted(). Indices and payloads move together, and equal
+     * keys keep their previous order. Other queries are unaffected apart
+     * from their order within a cell; cells_sorted() is recomputed.
+     *
+     * Complexity: O(n log m) for n points and m points per cell.
+     */
+    template<typename Getter>
+    void sort_cells_by_key(Getter get) {
+        static_assert(!std::is_void<Payload>::value, "sort_cells_by_key() needs a Payload type");
+        bool sorted = true;
+        for (size_t c = 0; c < grid_.size(); ++c) {
+            const payload_type* payload = payloads_.data(c);
+            const size_t n = grid_[c].size();
+            size_t k = 1;
+            while (k < n && !(grid_attribute(get, payload[k]) < grid_attribute(get, payload[k - 1]))) ++k;
+            if (k < n) {
+                payloads_.sort_cell_by(c, grid_[c], [&](size_t a, size_t b) {
+                    return grid_attribute(get, payload[a]) < grid_attribute(get, payload[b]);
+                });
+            }
+            if (sorted && !std::is_sorted(grid_[c].begin(), grid_[c].end())) sorted = false;
+        }
+        cells_sorted_ = sorted;
+        cells_key_sorted_ = true;
+    }
+
+    /**
+     * @brief Trim every cell's capacity to its exact size
+     *
+     * Removes the up to 2x slack left by push_back growth after an
+     * insert-based build. Cells are reallocated, so call it once after
+     * building rather than between inserts.
+     *
+     * Complexity: O(number of cells + number of points).
+     */
+    void shrink_to_fit() {
+        for (auto& cell : grid_) {
+            if (cell.capacity() != cell.size()) {
+                std::vector<size_t>(cell).swap(cell);
+            }
+        }
+        payloads_.shrink_to_fit();
+    }
+
+    /**
+     * @brief Number of points stored in each cell
+     * @return Vector indexed by linear cell id (j * nx + i)
+     *
+     * Save it as a fold map to presize the next index over the same
+     * geometry (see the cell-count constructor and reserve_cells()).
+     */
+    std::vector<size_t> get_cell_counts() const {
+        std::vector<size_t> counts(grid_.size());
+        for (size_t c = 0; c < grid_.size(); ++c) {
+            counts[c] = grid_[c].size();
+        }
+        return counts;
+    }
+
+    /**
+     * @brief Count how many of the given points fall into each cell
      *
-     * More efficient than query_box() when you don't need to store results.
+     * @return Vector indexed by linear cell id (j * nx + i); does not modify the grid
      *
-     * Example:
-     * @code
-     * grid.query_box_callback(0, 10, 0, 10, [&](size_t idx) {
-     *     std::cout << "Found point: " << idx << std::endl;
-     * });
-     * @endcode
+     * Use it as the first pass of a two-pass build when points are streamed
+     * in chunks: count all chunks, presize with reserve_cells(), then insert.
      */
-    template<typename Callback>
-    void query_box_callback(T x1, T x2, T y1, T y2, Callback callback,
-                           bool include_min = true, bool include_max = true) const {
-        // Get cell ranges
-        int i_min, i_max, j_min, j_max;
-        get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max,
-                      include_min, include_max);
-
-        // Call callback for each index in range
-        for (int j = j_min; j <= j_max; ++j) {
-            for (int i = i_min; i <= i_max; ++i) {
-                int cell_id = get_cell_id(i, j);
-                const auto& cell = grid_[cell_id];
-                for (size_t idx : cell) {
-                    callback(idx);
-                }
+    std::vector<size_t> count_cells(const T* xs, const T* ys, size_t n) const {
+        std::vector<size_t> counts(grid_.size(), 0);
+        int cell_ids[256];
+        for (size_t first = 0; first < n; first += 256) {
+            const size_t chunk = std::min<size_t>(256, n - first);
+            compute_cell_ids(xs + first, ys + first, chunk, cell_ids);
+            for (size_t k = 0; k < chunk; ++k) {
+                ++counts[cell_ids[k]];
             }
         }
+        return counts;
     }
 
     /**
-     * @brief Clear all data from the grid
+     * @brief Compute the linear cell id (j * nx + i) of each point
+     *
+     * @param xs X coordinates of n points
+     * @param ys Y coordinates of n points
+     * @param n Number of points
+     * @param out Receives n cell ids
+     *
+     * Gives the same ids as insert() (points outside the grid clamp to the
+     * edge cells). For float and double on x86-64 the bulk of the array is
+     * mapped with AVX-512 or AVX2 when the CPU supports it, see
+     * grid_simd_level(); the remainder, and other coordinate types, use the
+     * scalar mapping.
      */
-    void clear() {
-        for (auto& cell : grid_) {
-            cell.clear();
+    void compute_cell_ids(const T* xs, const T* ys, size_t n, int* out) const {
+        size_t k = grid_cell_ids_simd(xs, ys, n, x_axis_, y_axis_, out);
+        for (; k < n; ++k) {
+            out[k] = get_cell_id(get_cell_x(xs[k]), get_cell_y(ys[k]));
+        }
+    }
+
+    /**
+     * @brief Reserve per-cell capacities before inserting
+     *
+     * @param counts Expected number of points per cell, indexed by linear
+     *        cell id (j * nx + i), e.g. from a previous run's fold map
+     *
+     * Each cell is reserved to hold at least counts[cell_id] points in total,
+     * so inserting up to that many points never reallocates.
+     *
+     * @throws std::invalid_argument if counts.size() != get_num_cells()
+     */
+    void reserve_cells(const std::vector<size_t>& counts) {
+        if (counts.size() != grid_.size()) {
+            throw std::invalid_argument("Cell count array size must match number of cells");
+        }
+        for (size_t c = 0; c < grid_.size(); ++c) {
+            grid_[c].reserve(counts[c]);
+            payloads_.reserve(c, counts[c]);
         }
     }
 
@@ -250,13 +2394,11 @@ public:
     /**
      * @brief Get the total number of points stored in the grid
      * @return size_t Total number of point indices
+     *
+     * Complexity: O(1), the count is maintained by insert() and clear().
      */
     size_t get_num_points() const {
-        size_t count = 0;
-        for (const auto& cell : grid_) {
-            count += cell.size();
-        }
-        return count;
+        return num_points_;
     }
 
     /**
@@ -279,17 +2421,305 @@ public:
         y_end = y_end_;
     }
 
+    /**
+     * @brief Get the range of cells a box query reads
+     *
+     * Cells (i, j) with i_min <= i <= i_max and j_min <= j <= j_max are the
+     * cells query_box() visits for the same arguments. Together with
+     * get_cell() this lets external drivers such as grid_index_async.h
+     * schedule the cell reads themselves.
+     */
+    void get_box_cell_range(T x1, T x2, T y1, T y2,
+                            int& i_min, int& i_max, int& j_min, int& j_max,
+                            bool include_min = true, bool include_max = true) const {
+        get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max, include_min, include_max);
+    }
+
+    /**
+     * @brief Get the indices stored in cell (i, j), valid until the grid is modified
+     */
+    const std::vector<size_t>& get_cell(int i, int j) const {
+        return grid_[get_cell_id(i, j)];
+    }
+
+    /**
+     * @brief Get the payloads of cell (i, j), parallel to get_cell(i, j)
+     */
+    const std::vector<payload_type>& get_cell_payloads(int i, int j) const {
+        static_assert(!std::is_void<Payload>::value, "get_cell_payloads() needs a Payload type");
+        return payloads_.cells[get_cell_id(i, j)];
+    }
+
+    /**
+     * @brief Report bytes used and reserved per component
+     *
+     * Use total_reserved() to size memory limits; a large gap to
+     * total_used() is capacity slack from insert-based building.
+     *
+     * Complexity: O(number of cells).
+     */
+    GridMemoryUsage memory_usage() const {
+        GridMemoryUsage usage;
+        usage.object_bytes = sizeof(*this);
+        usage.cell_headers_used = grid_.size() * sizeof(std::vector<size_t>);
+        usage.cell_headers_reserved = grid_.capacity() * sizeof(std::vector<size_t>);
+        usage.indices_used = num_points_ * sizeof(size_t);
+        size_t capacity = 0;
+        for (const auto& cell : grid_) {
+            capacity += cell.capacity();
+        }
+        usage.indices_reserved = capacity * sizeof(size_t);
+        payloads_.usage(usage.payloads_used, usage.payloads_reserved);
+        return usage;
+    }
+
+    /**
+     * @brief Compute the cell occupancy distribution
+     *
+     * Complexity: O(number of cells).
+     */
+    GridOccupancy occupancy() const {
+        GridOccupancy occ;
+        occ.num_cells = grid_.size();
+        occ.num_points = num_points_;
+        occ.empty_cells = 0;
+        occ.max_cell_size = 0;
+        occ.mean_cell_size = grid_.empty() ? 0.0
+            : static_cast<double>(num_points_) / static_cast<double>(grid_.size());
+
+        std::vector<size_t> sizes;
+        sizes.reserve(grid_.size());
+        for (const auto& cell : grid_) {
+            const size_t n = cell.size();
+            sizes.push_back(n);
+            occ.max_cell_size = std::max(occ.max_cell_size, n);
+            size_t bucket = 0;
+            while ((size_t(1) << bucket) <= n) ++bucket;  // 0 for empty, else floor(log2 n) + 1
+            if (occ.size_histogram.size() <= bucket) occ.size_histogram.resize(bucket + 1, 0);
+            ++occ.size_histogram[bucket];
+            if (n == 0) ++occ.empty_cells;
+        }
+
+        occ.p50_cell_size = cell_size_percentile(sizes, 0.50);
+        occ.p90_cell_size = cell_size_percentile(sizes, 0.90);
+        occ.p99_cell_size = cell_size_percentile(sizes, 0.99);
+        return occ;
+    }
+
+    /**
+     * @brief Query work counters of the calling thread
+     *
+     * Counts accumulate over all queries issued by this thread (on any grid)
+     * since the last reset_query_stats(). Always zero unless compiled with
+     * GRID_INDEX_ENABLE_QUERY_STATS.
+     *
+     * Example:
+     * @code
+     * GridIndex2D<float>::reset_query_stats();
+     * grid.query_box_no_alloc(x1, x2, y1, y2, result);
+     * GridQueryStats stats = GridIndex2D<float>::query_stats();
+     * double false_cell_ratio = double(stats.empty_cells_skipped) / stats.cells_visited;
+     * @endcode
+     */
+    static GridQueryStats query_stats() {
+        return grid_query_stats_thread_local();
+    }
+
+    /**
+     * @brief Reset the query work counters of the calling thread
+     */
+    static void reset_query_stats() {
+        grid_query_stats_thread_local() = GridQueryStats();
+    }
+
+    /**
+     * @brief Latency histogram of one query API, merged over all threads
+     *
+     * Covers queries on all grids since the last reset_query_latency().
+     * Empty unless compiled with GRID_INDEX_ENABLE_LATENCY_HISTOGRAMS.
+     *
+     * Example:
+     * @code
+     * LatencySummary s = GridIndex2D<float>::query_latency(GRID_QUERY_BOX_NO_ALLOC).summary();
+     * std::cout << "p99: " << s.p99_ns << " ns\n";
+     * @endcode
+     */
+    static LatencyHistogram query_latency(GridQueryKind kind) {
+        return grid_latency_registry().snapshot(kind);
+    }
+
+    /**
+     * @brief Restart all latency histograms from zero
+     */
+    static void reset_query_latency() {
+        grid_latency_registry().reset();
+    }
+
 private:
+    template<typename, typename> friend class TemporalGridIndex2D;
+
     T x_start_, x_end_, x_step_;
     T y_start_, y_end_, y_step_;
+    GridCellAxis<T> x_axis_, y_axis_;  // Cell mapping parameters, see GridAxisMath
+
+    struct CellRange {
+        int i_min, i_max, j_min, j_max;
+    };
+
+    struct IndexSpan {
+        const size_t* begin;
+        const size_t* end;
+    };
+
+    struct CellDistance {
+        double d2;  // Squared minimum distance to the query centre
+        int cell;
+    };
+
+    struct PointDistance {
+        double d2;
+        size_t index;
+    };
+
+    /**
+     * @brief Lower bound on |c - x| for any x stored in cell i of an axis
+     *
+     * The outer cells also hold clamped out-of-range points, so they are
+     * unbounded outwards. Floating-point edges are widened by the rounding
+     * error of x - start and i * step in T.
+     */
+    static double cell_gap(int i, int n, double c, const GridCellAxis<T>& a) {
+        const double start = static_cast<double>(a.start);
+        const double step = static_cast<double>(a.step);
+        const double slack = std::numeric_limits<T>::is_integer ? 0.0 :
+            2.0 * static_cast<double>(std::numeric_limits<T>::epsilon()) *
+            (std::fabs(start) + n * step);
+        double gap = 0.0;
+        if (i > 0) gap = std::max(gap, start + i * step - slack - c);
+        if (i < n - 1) gap = std::max(gap, c - (start + (i + 1) * step) - slack);
+        return gap;
+    }
+
+    /**
+     * @brief Append the union of ascending index lists to result, ascending
+     *
+     * Lists are ordered by first index; consecutive lists that do not
+     * overlap (the common case for spatially coherent numbering) are
+     * copied as blocks. Overlapping lists go through a min-heap keyed on
+     * their next index, emitting from the top list for as long as it stays
+     * below both children. More than 64 overlapping lists are copied and
+     * sorted instead.
+     */
+    static void merge_sorted_spans(std::vector<IndexSpan>& spans, std::vector<size_t>& result) {
+        std::sort(spans.begin(), spans.end(), [](const IndexSpan& a, const IndexSpan& b) {
+            return *a.begin < *b.begin;
+        });
+        bool disjoint = true;
+        for (size_t k = 1; k < spans.size() && disjoint; ++k) {
+            disjoint = *(spans[k - 1].end - 1) <= *spans[k].begin;
+        }
+        if (disjoint) {
+            for (size_t k = 0; k < spans.size(); ++k) {
+                result.insert(result.end(), spans[k].begin, spans[k].end);
+            }
+            return;
+        }
+
+        // Past a few dozen overlapping lists the heap's log k compares per
+        // index lose to one pass of std::sort over the collected result
+        if (spans.size() > 64) {
+            const size_t first = result.size();
+            for (size_t k = 0; k < spans.size(); ++k) {
+                result.insert(result.end(), spans[k].begin, spans[k].end);
+            }
+            std::sort(result.begin() + first, result.end());
+            return;
+        }
+
+        // Sorted by first index, spans already form a valid min-heap
+        size_t heap_size = spans.size();
+        while (heap_size > 0) {
+            IndexSpan& top = spans[0];
+            size_t bound = SIZE_MAX;  // Smallest next index among the children
+            if (heap_size > 1) bound = *spans[1].begin;
+            if (heap_size > 2) bound = std::min(bound, *spans[2].begin);
+            do {
+                result.push_back(*top.begin++);
+            } while (top.begin != top.end && *top.begin <= bound);
+
+            if (top.begin == top.end) {
+                top = spans[--heap_size];
+            }
+            // Sift the (new) top down
+            size_t parent = 0;
+            for (;;) {
+                size_t child = 2 * parent + 1;
+                if (child >= heap_size) break;
+                if (child + 1 < heap_size && *spans[child + 1].begin < *spans[child].begin) ++child;
+                if (*spans[parent].begin <= *spans[child].begin) break;
+                std::swap(spans[parent], spans[child]);
+                parent = child;
+            }
+        }
+    }
     int nx_, ny_;  // Number of cells in each dimension
     std::vector<std::vector<size_t>> grid_;  // Flat grid: grid_[j*nx + i]
+    GridPayloadCells<Payload> payloads_;     // Parallel to grid_; empty without Payload
+    size_t num_points_;  // Total indices stored in grid_
+    bool cells_sorted_;  // Every cell is in ascending index order
+    bool cells_key_sorted_;  // Every cell is in sort_cells_by_key() order
+    size_t version_;     // Bumped by every insert and clear; see GridAttributeSummary
+
+    /**
+     * @brief Counting-sort build behind insert_points(); payloads may be null only without Payload
+     */
+    void insert_cells(const T* xs, const T* ys, const payload_type* payloads, size_t n,
+                      size_t first_index) {
+        std::vector<int> cell_ids(n);
+        compute_cell_ids(xs, ys, n, cell_ids.data());
+
+        std::vector<size_t> counts(grid_.size(), 0);
+        for (size_t k = 0; k < n; ++k) {
+            ++counts[cell_ids[k]];
+        }
+        for (size_t c = 0; c < grid_.size(); ++c) {
+            const size_t needed = grid_[c].size() + counts[c];
+            if (!counts[c] || needed <= grid_[c].capacity()) continue;
+            // Exact for the first batch of a cell, geometric for later ones so
+            // that repeated batches do not copy the cell every time
+            const size_t capacity = grid_[c].empty() ? needed
+                                                     : std::max(needed, 2 * grid_[c].capacity());
+            grid_[c].reserve(capacity);
+            payloads_.reserve(c, capacity);
+        }
+
+        for (size_t k = 0; k < n; ++k) {
+            std::vector<size_t>& cell = grid_[cell_ids[k]];
+            if (!cell.empty() && first_index + k < cell.back()) cells_sorted_ = false;
+            cell.push_back(first_index + k);
+            if (payloads) payloads_.push(cell_ids[k], payloads[k]);
+        }
+        num_points_ += n;
+        cells_key_sorted_ = false;
+        ++version_;
+    }
+
+    /**
+     * @brief Nearest-rank percentile of cell sizes (reorders sizes)
+     */
+    static size_t cell_size_percentile(std::vector<size_t>& sizes, double q) {
+        if (sizes.empty()) return 0;
+        size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(sizes.size())));
+        if (rank > 0) --rank;
+        std::nth_element(sizes.begin(), sizes.begin() + rank, sizes.end());
+        return sizes[rank];
+    }
 
     /**
      * @brief Convert x coordinate to cell index (clamped to valid range)
      */
     int get_cell_x(T x) const {
-        int i = static_cast<int>(std::floor((x - x_start_) / x_step_));
+        int i = GridAxisMath<T>::floor_cell(x, x_axis_);
         return std::max(0, std::min(i, nx_ - 1));
     }
 
@@ -297,7 +2727,7 @@ private:
      * @brief Convert y coordinate to cell index (clamped to valid range)
      */
     int get_cell_y(T y) const {
-        int j = static_cast<int>(std::floor((y - y_start_) / y_step_));
+        int j = GridAxisMath<T>::floor_cell(y, y_axis_);
         return std::max(0, std::min(j, ny_ - 1));
     }
 
@@ -308,50 +2738,141 @@ private:
         return j * nx_ + i;
     }
 
+    /**
+     * @brief Get range of cells that intersect with a box query (runtime edge flags)
+     */
+    void get_cell_range(T x1, T x2, T y1, T y2,
+                        int& i_min, int& i_max, int& j_min, int& j_max,
+                        bool include_min, bool include_max) const {
+        switch (grid_edges(include_min, include_max)) {
+        case Edges::Exclusive:
+            get_cell_range<Edges::Exclusive>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+            break;
+        case Edges::HalfOpen:
+            get_cell_range<Edges::HalfOpen>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+            break;
+        case Edges::ReverseHalfOpen:
+            get_cell_range<Edges::ReverseHalfOpen>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+            break;
+        default:
+            get_cell_range<Edges::Inclusive>(x1, x2, y1, y2, i_min, i_max, j_min, j_max);
+            break;
+        }
+    }
+
+    /**
+     * @brief Prefetch ahead of a row-major scan of [i_min, i_max] x [., j_max] at (i, j)
+     *
+     * Prefetches the index list of the cell GRID_INDEX_PREFETCH_DISTANCE
+     * positions ahead, wrapping into the next row, and on the first cell
+     * of a row the next row's cell headers. With payloads set, also the
+     * payloads of that cell.
+     */
+    void prefetch_scan(int i, int j, int i_min, int i_max, int j_max,
+                       bool payloads = false) const {
+#if GRID_INDEX_PREFETCH_DISTANCE > 0
+        if (i == i_min && j < j_max) {
+            const char* p = reinterpret_cast<const char*>(&grid_[get_cell_id(i_min, j + 1)]);
+            const char* last = reinterpret_cast<const char*>(&grid_[get_cell_id(i_max, j + 1)] + 1) - 1;
+            for (; p < last; p += 64) grid_prefetch(p);
+            grid_prefetch(last);
+        }
+        int ti = i + GRID_INDEX_PREFETCH_DISTANCE, tj = j;
+        if (ti > i_max) {
+            ti += i_min - i_max - 1;
+            if (++tj > j_max || ti > i_max) return;
+        }
+        const int id = get_cell_id(ti, tj);
+        const auto& cell = grid_[id];
+        if (cell.empty()) return;
+        grid_prefetch(cell.data());
+        if (payloads) grid_prefetch(payloads_.data(id));
+#else
+        (void)i; (void)j; (void)i_min; (void)i_max; (void)j_max; (void)payloads;
+#endif
+    }
+
+    /**
+     * @brief Call visit(cell) for the cells of a range until it returns false
+     *
+     * CenterOut visits the middle cell of the range first, then the rings
+     * of cells at Chebyshev distance 1, 2, ... from it, clipped to the range.
+     *
+     * @return false if visit stopped the scan
+     */
+    template<typename CellVisitor>
+    bool visit_cells(int i_min, int i_max, int j_min, int j_max, CellOrder order,
+                     CellVisitor visit) const {
+        if (i_min > i_max || j_min > j_max) return true;
+        if (order == CellOrder::RowMajor) {
+            for (int j = j_min; j <= j_max; ++j) {
+                for (int i = i_min; i <= i_max; ++i) {
+                    prefetch_scan(i, j, i_min, i_max, j_max);
+                    if (!visit(grid_[get_cell_id(i, j)])) return false;
+                }
+            }
+            return true;
+        }
+
+        const int ci = i_min + (i_max - i_min) / 2;
+        const int cj = j_min + (j_max - j_min) / 2;
+        const int max_r = std::max(std::max(ci - i_min, i_max - ci),
+                                   std::max(cj - j_min, j_max - cj));
+        if (!visit(grid_[get_cell_id(ci, cj)])) return false;
+        for (int r = 1; r <= max_r; ++r) {
+            const int lo_i = std::max(ci - r, i_min), hi_i = std::min(ci + r, i_max);
+            // Bottom and top rows of the ring
+            for (int side = 0; side < 2; ++side) {
+                const int j = side ? cj + r : cj - r;
+                if (j < j_min || j > j_max) continue;
+                for (int i = lo_i; i <= hi_i; ++i) {
+                    if (!visit(grid_[get_cell_id(i, j)])) return false;
+                }
+            }
+            // Left and right columns without the corners
+            const int lo_j = std::max(cj - r + 1, j_min), hi_j = std::min(cj + r - 1, j_max);
+            for (int side = 0; side < 2; ++side) {
+                const int i = side ? ci + r : ci - r;
+                if (i < i_min || i > i_max) continue;
+                for (int j = lo_j; j <= hi_j; ++j) {
+                    if (!visit(grid_[get_cell_id(i, j)])) return false;
+                }
+            }
+        }
+        return true;
+    }
+
     /**
      * @brief Get range of cells that intersect with a box query
+     *
+     * A box edge lying exactly on a cell edge (GridAxisMath::on_edge())
+     * excludes the cell beyond it when that side of the box is open. The
+     * edge tests are only compiled in for open sides.
      */
+    template<Edges E>
     void get_cell_range(T x1, T x2, T y1, T y2,
                        int& i_min, int& i_max,
-                       int& j_min, int& j_max,
-                       bool include_min = true, bool include_max = true) const {
+                       int& j_min, int& j_max) const {
         // Ensure x1 <= x2 and y1 <= y2
         if (x1 > x2) std::swap(x1, x2);
         if (y1 > y2) std::swap(y1, y2);
 
         // Convert coordinates to cell indices
-        i_min = static_cast<int>(std::floor((x1 - x_start_) / x_step_));
-        i_max = static_cast<int>(std::floor((x2 - x_start_) / x_step_));
-        j_min = static_cast<int>(std::floor((y1 - y_start_) / y_step_));
-        j_max = static_cast<int>(std::floor((y2 - y_start_) / y_step_));
+        i_min = GridAxisMath<T>::floor_cell(x1, x_axis_);
+        i_max = GridAxisMath<T>::floor_cell(x2, x_axis_);
+        j_min = GridAxisMath<T>::floor_cell(y1, y_axis_);
+        j_max = GridAxisMath<T>::floor_cell(y2, y_axis_);
 
-        // Adjust for edge inclusion/exclusion
         // If we exclude the minimum edge and x1/y1 is exactly on a cell boundary, skip that cell
-        if (!include_min) {
-            // Check if x1 is exactly on a cell boundary
-            T x1_normalized = (x1 - x_start_) / x_step_;
-            if (x1_normalized == std::floor(x1_normalized)) {
-                i_min++;
-            }
-            // Check if y1 is exactly on a cell boundary
-            T y1_normalized = (y1 - y_start_) / y_step_;
-            if (y1_normalized == std::floor(y1_normalized)) {
-                j_min++;
-            }
+        if (!GridEdgeFlags<E>::include_min) {
+            if (GridAxisMath<T>::on_edge(x1, i_min, x_axis_)) i_min++;
+            if (GridAxisMath<T>::on_edge(y1, j_min, y_axis_)) j_min++;
         }
 
         // If we exclude the maximum edge and x2/y2 is exactly on a cell boundary, skip that cell
-        if (!include_max) {
-            // Check if x2 is exactly on a cell boundary
-            T x2_normalized = (x2 - x_start_) / x_step_;
-            if (x2_normalized == std::floor(x2_normalized)) {
-                i_max--;
-            }
-            // Check if y2 is exactly on a cell boundary
-            T y2_normalized = (y2 - y_start_) / y_step_;
-            if (y2_normalized == std::floor(y2_normalized)) {
-                j_max--;
-            }
+        if (!GridEdgeFlags<E>::include_max) {
+            if (GridAxisMath<T>::on_edge(x2, i_max, x_axis_)) i_max--;
+            if (GridAxisMath<T>::on_edge(y2, j_max, y_axis_)) j_max--;
         }
 
         // Clamp to valid range
@@ -362,4 +2883,254 @@ private:
     }
 };
 
+/**
+ * @brief Grid index over repeated surveys: box x time window queries
+ *
+ * @tparam T Coordinate type
+ * @tparam Time Timestamp type (e.g. double seconds or int64_t epoch numbers)
+ *
+ * Every cell holds its points in timestamp order, with the timestamps
+ * stored next to the indices. A time window is then one contiguous run per
+ * cell, found by binary search. New epochs are appended to the cell tails.
+ * Old epochs are expired by advancing a per-cell start offset. The
+ * expired prefix of a cell is compacted away once it makes up half of the
+ * cell, so expiry is amortized O(1) per point and never rebuilds the index.
+ * Compaction keeps the cell capacity for the next epochs; clear(true)
+ * releases it.
+ */
+template<typename T, typename Time = double>
+class TemporalGridIndex2D {
+public:
+    typedef Time time_type;
+
+    /**
+     * @brief Construct an empty temporal index
+     *
+     * Parameters as for GridIndex2D.
+     *
+     * @throws std::invalid_argument if step values are <= 0 or if start >= end
+     */
+    TemporalGridIndex2D(T x_start, T x_end, T x_step,
+                        T y_start, T y_end, T y_step)
+        : grid_(x_start, x_end, x_step, y_start, y_end, y_step),
+          heads_(grid_.get_num_cells(), 0),
+          num_points_(0),
+          earliest_(std::numeric_limits<Time>::lowest()),
+          latest_(std::numeric_limits<Time>::lowest()) {}
+
+    /**
+     * @brief Append an epoch of points with their timestamps
+     *
+     * @param xs X coordinates of n points
+     * @param ys Y coordinates of n points
+     * @param times Timestamps of the n points
+     * @param n Number of points
+     * @param first_index Index stored for xs[0]; point k gets first_index + k
+     *
+     * Timestamps must not precede latest_time(), so appending only extends
+     * the cell tails (counting-sort build as GridIndex2D::insert_points()).
+     * Timestamps in ascending order cost nothing more. Otherwise the points
+     * appended to each cell are additionally sorted by time.
+     *
+     * @throws std::invalid_argument if a timestamp is older than
+     *         latest_time() or NaN; nothing is inserted then
+     */
+    void append_epoch(const T* xs, const T* ys, const Time* times, size_t n,
+                      size_t first_index = 0) {
+        bool ordered = true;
+        for (size_t k = 0; k < n; ++k) {
+            if (!(times[k] >= latest_)) {
+                throw std::invalid_argument("Timestamps must not precede latest_time()");
+            }
+            if (k > 0 && times[k] < times[k - 1]) ordered = false;
+        }
+        if (n == 0) return;
+        std::vector<size_t> tails;
+        if (!ordered) {
+            tails.resize(heads_.size());
+            for (size_t c = 0; c < heads_.size(); ++c) tails[c] = grid_.grid_[c].size();
+        }
+        grid_.insert_points(xs, ys, times, n, first_index);
+        if (!ordered) {
+            // Only the appended tails need sorting: no new timestamp precedes
+            // latest_time(), so each tail already follows the rest of its cell
+            for (size_t c = 0; c < heads_.size(); ++c) {
+                std::vector<Time>& t = grid_.payloads_.cells[c];
+                if (std::is_sorted(t.begin() + tails[c], t.end())) continue;
+                grid_.payloads_.sort_cell_by(c, grid_.grid_[c], [&](size_t a, size_t b) {
+                    return t[a] < t[b];
+                }, tails[c]);
+            }
+        }
+        if (num_points_ == 0) {
+            earliest_ = *std::min_element(times, times + n);
+        }
+        latest_ = std::max(latest_, *std::max_element(times, times + n));
+        num_points_ += n;
+    }
+
+    /**
+     * @brief Append an epoch whose points share one timestamp
+     */
+    void append_epoch(const T* xs, const T* ys, Time time, size_t n, size_t first_index = 0) {
+        const std::vector<Time> times(n, time);
+        append_epoch(xs, ys, times.data(), n, first_index);
+    }
+
+    /**
+     * @brief Remove every point with a timestamp before t (retention)
+     *
+     * @return Number of points removed
+     *
+     * Per cell, the start offset moves past the expired run (binary
+     * search). A cell is compacted once its expired prefix reaches half
+     * of it; its capacity is kept. For a retention window w, call
+     * expire_before(latest_time() - w) after each append_epoch().
+     *
+     * Complexity: O(number of cells * log m) plus amortized O(1) per removed point.
+     */
+    size_t expire_before(Time t) {
+        if (num_points_ == 0 || !(earliest_ < t)) return 0;
+        size_t removed = 0;
+        for (size_t c = 0; c < heads_.size(); ++c) {
+            std::vector<size_t>& cell = grid_.grid_[c];
+            std::vector<Time>& times = grid_.payloads_.cells[c];
+            const size_t head = static_cast<size_t>(
+                std::lower_bound(times.begin() + heads_[c], times.end(), t) - times.begin());
+            removed += head - heads_[c];
+            if (2 * head >= cell.size()) {
+                cell.erase(cell.begin(), cell.begin() + head);
+                times.erase(times.begin(), times.begin() + head);
+                heads_[c] = 0;
+            } else {
+                heads_[c] = head;
+            }
+        }
+        grid_.num_points_ -= removed;
+        num_points_ -= removed;
+        earliest_ = num_points_ ? t : std::numeric_limits<Time>::lowest();
+        if (num_points_ == 0) latest_ = std::numeric_limits<Time>::lowest();
+        return removed;
+    }
+
+    /**
+     * @brief Query the point indices of a box with timestamps in [t0, t1]
+     *
+     * @param x1 Minimum x coordinate of the query box
+     * @param x2 Maximum x coordinate of the query box
+     * @param y1 Minimum y coordinate of the query box
+     * @param y2 Maximum y coordinate of the query box
+     * @param t0 Start of the time window
+     * @param t1 End of the time window (t0 > t1 selects nothing)
+     * @param result Receives the indices, cell by cell in time order (cleared first)
+     * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+     * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+     * @return Number of indices written to result
+     */
+    size_t query_box(T x1, T x2, T y1, T y2, Time t0, Time t1, std::vector<size_t>& result,
+                     bool include_min = true, bool include_max = true) const {
+        GRID_INDEX_LATENCY(GridLatencyTimer latency(GRID_QUERY_BOX_TIME);)
+        GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+        result.clear();
+
+        int i_min, i_max, j_min, j_max;
+        grid_.get_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max, include_min, include_max);
+
+        for (int j = j_min; j <= j_max; ++j) {
+            for (int i = i_min; i <= i_max; ++i) {
+                grid_.prefetch_scan(i, j, i_min, i_max, j_max, true);
+                const int cell_id = grid_.get_cell_id(i, j);
+                const std::vector<size_t>& cell = grid_.grid_[cell_id];
+                const std::vector<Time>& times = grid_.payloads_.cells[cell_id];
+                const size_t head = heads_[cell_id];
+                GRID_INDEX_STATS(stats.cell(cell.size() - head);)
+                if (cell.size() == head || t1 < t0) continue;
+                // The cell's time span decides most cells without a search
+                if (times.back() < t0 || t1 < times[head]) continue;
+                if (!(times[head] < t0) && !(t1 < times.back())) {
+                    result.insert(result.end(), cell.begin() + head, cell.end());
+                    continue;
+                }
+                const typename std::vector<Time>::const_iterator first =
+                    std::lower_bound(times.begin() + head, times.end(), t0);
+                const typename std::vector<Time>::const_iterator last =
+                    std::upper_bound(first, times.end(), t1);
+                result.insert(result.end(), cell.begin() + (first - times.begin()),
+                              cell.begin() + (last - times.begin()));
+            }
+        }
+        GRID_INDEX_STATS(stats.emit(result.size());)
+        return result.size();
+    }
+
+    /**
+     * @brief Query the point indices of a box with timestamps in [t0, t1]
+     * @return std::vector<size_t> The indices, cell by cell in time order
+     */
+    std::vector<size_t> query_box(T x1, T x2, T y1, T y2, Time t0, Time t1,
+                                  bool include_min = true, bool include_max = true) const {
+        std::vector<size_t> result;
+        query_box(x1, x2, y1, y2, t0, t1, result, include_min, include_max);
+        return result;
+    }
+
+    /**
+     * @brief Remove all points, keep the cell structure
+     */
+    void clear(bool release_memory = false) {
+        grid_.clear(release_memory);
+        std::fill(heads_.begin(), heads_.end(), 0);
+        num_points_ = 0;
+        earliest_ = std::numeric_limits<Time>::lowest();
+        latest_ = std::numeric_limits<Time>::lowest();
+    }
+
+    /** @brief Number of points not yet expired */
+    size_t get_num_points() const {
+        return num_points_;
+    }
+
+    size_t get_num_cells() const {
+        return grid_.get_num_cells();
+    }
+
+    /**
+     * @brief Lower bound of the stored timestamps (lowest() when empty)
+     *
+     * After expire_before(t) this is t, not necessarily the oldest stored timestamp.
+     */
+    Time earliest_time() const {
+        return earliest_;
+    }
+
+    /** @brief Newest timestamp appended (lowest() when empty) */
+    Time latest_time() const {
+        return latest_;
+    }
+
+    /**
+     * @brief Memory held by the index; payloads_* are the timestamps
+     *
+     * Expired points not yet compacted count as reserved, not used. The
+     * per-cell start offsets are included in the cell headers.
+     */
+    GridMemoryUsage memory_usage() const {
+        GridMemoryUsage usage = grid_.memory_usage();
+        size_t expired = 0;
+        for (size_t c = 0; c < heads_.size(); ++c) expired += heads_[c];
+        usage.object_bytes = sizeof(*this);
+        usage.cell_headers_used += heads_.size() * sizeof(size_t);
+        usage.cell_headers_reserved += heads_.capacity() * sizeof(size_t);
+        usage.payloads_used -= expired * sizeof(Time);
+        return usage;
+    }
+
+private:
+    GridIndex2D<T, Time> grid_;  // Cells in time order; timestamps as payloads
+    std::vector<size_t> heads_;  // Per cell: number of expired entries at the front
+    size_t num_points_;          // Points not yet expired
+    Time earliest_;              // No stored timestamp is older
+    Time latest_;                // No stored timestamp is newer
+};
+
 #endif // GRID_INDEX_H
@@ -0,0 +1,347 @@
+/**
+ * @file grid_index_async.h
+ * @brief Interleaved box queries on C++20 coroutines
+ *
+ * A box query spends most of its time waiting for cell storage: the index
+ * lists of a cell are a separate allocation, and for large grids (or grids
+ * whose pages were swapped out) reading them misses the caches or faults.
+ * Running queries as coroutines lets one query announce the cell it will
+ * read next, suspend, and let other queries run while that memory is
+ * fetched. GridInterleavedExecutor resumes a fixed number of in-flight
+ * queries round-robin, so each prefetch has a whole round to complete.
+ *
+ * Requires C++20; grid_index.h itself stays C++11.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef GRID_INDEX_ASYNC_H
+#define GRID_INDEX_ASYNC_H
+
+#if __cplusplus < 202002L
+#error "grid_index_async.h requires C++20 (coroutines)"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "grid_index.h"
+
+/**
+ * @brief Called with the memory range a query reads after its next resumption
+ */
+using GridPrefetchHook = void (*)(const void* addr, size_t bytes);
+
+/**
+ * @brief Prefetch hook for in-memory grids: pull the first cache lines of the range
+ *
+ * Only the head of a long cell is prefetched; the hardware prefetcher
+ * follows the sequential read from there.
+ */
+inline void grid_prefetch_cache(const void* addr, size_t bytes) {
+    const char* p = static_cast<const char*>(addr);
+    const size_t lines = std::min<size_t>((bytes + 63) / 64, 4);
+    for (size_t k = 0; k < lines; ++k) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p + 64 * k);
+#else
+        (void)p;
+#endif
+    }
+}
+
+/**
+ * @brief Prefetch hook for swapped-out or file-backed storage: madvise(MADV_WILLNEED)
+ *
+ * Starts asynchronous read-ahead of the pages covering the range. Also
+ * prefetches the first cache lines, as grid_prefetch_cache() does. On
+ * systems without madvise() only the cache prefetch is done.
+ */
+inline void grid_prefetch_willneed(const void* addr, size_t bytes) {
+#if defined(__unix__) || defined(__APPLE__)
+    static const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(addr) & ~(page - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(addr) + bytes;
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+#endif
+    grid_prefetch_cache(addr, bytes);
+}
+
+/**
+ * @brief Handle to a suspended query coroutine
+ *
+ * Queries start suspended and run only when resumed, normally by
+ * GridInterleavedExecutor. The handle owns the coroutine frame.
+ */
+class GridQueryTask {
+public:
+    struct promise_type {
+        std::exception_ptr error;
+
+        GridQueryTask get_return_object() {
+            return GridQueryTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        // Frames are recycled per thread: batches create one per query
+        static void* operator new(size_t bytes) {
+            FrameCache& cache = frame_cache();
+            if (bytes <= FRAME_BLOCK && cache.head) {
+                FreeFrame* f = cache.head;
+                cache.head = f->next;
+                --cache.count;
+                return f;
+            }
+            return ::operator new(bytes <= FRAME_BLOCK ? FRAME_BLOCK : bytes);
+        }
+        static void operator delete(void* p, size_t bytes) {
+            FrameCache& cache = frame_cache();
+            if (bytes <= FRAME_BLOCK && cache.count < FRAME_CACHE_SIZE) {
+                FreeFrame* f = static_cast<FreeFrame*>(p);
+                f->next = cache.head;
+                cache.head = f;
+                ++cache.count;
+                return;
+            }
+            ::operator delete(p);
+        }
+    };
+
+    GridQueryTask() : handle_(nullptr) {}
+    GridQueryTask(GridQueryTask&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    GridQueryTask& operator=(GridQueryTask&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    GridQueryTask(const GridQueryTask&) = delete;
+    GridQueryTask& operator=(const GridQueryTask&) = delete;
+    ~GridQueryTask() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool done() const { return !handle_ || handle_.done(); }
+
+    /**
+     * @brief Run the query until its next suspension point
+     * @throws Whatever the query threw, once it has finished
+     */
+    void resume() {
+        if (done()) return;
+        handle_.resume();
+        if (handle_.done() && handle_.promise().error) {
+            std::rethrow_exception(handle_.promise().error);
+        }
+    }
+
+    /** @brief Run the query to completion without interleaving */
+    void run() {
+        while (!done()) resume();
+    }
+
+private:
+    static const size_t FRAME_BLOCK = 512;       // Frames up to this size are recycled
+    static const size_t FRAME_CACHE_SIZE = 256;  // Free frames kept per thread
+
+    struct FreeFrame {
+        FreeFrame* next;
+    };
+
+    struct FrameCache {
+        FreeFrame* head = nullptr;
+        size_t count = 0;
+        ~FrameCache() {
+            while (head) {
+                FreeFrame* next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    };
+
+    static FrameCache& frame_cache() {
+        static thread_local FrameCache cache;
+        return cache;
+    }
+
+    explicit GridQueryTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @brief Box query as a coroutine: same indices and order as query_box_no_alloc()
+ *
+ * @param grid Grid to query; must not be modified until the task finishes
+ * @param x1 Minimum x coordinate of the query box
+ * @param x2 Maximum x coordinate of the query box
+ * @param y1 Minimum y coordinate of the query box
+ * @param y2 Maximum y coordinate of the query box
+ * @param result Receives the indices (cleared when the task first runs)
+ * @param prefetch Hook called for each non-empty cell before suspending
+ * @param include_min Include lower edges (default: true) - [x1, [y1 vs (x1, (y1
+ * @param include_max Include upper edges (default: true) - x2], y2] vs x2), y2)
+ *
+ * Each row of cells takes two suspensions: one after prefetching the
+ * row's cell headers, one after prefetching the index lists of its
+ * non-empty cells. The indices are copied after the second.
+ */
+template<typename T>
+GridQueryTask async_query_box(const GridIndex2D<T>& grid, T x1, T x2, T y1, T y2,
+                              std::vector<size_t>& result,
+                              GridPrefetchHook prefetch = grid_prefetch_cache,
+                              bool include_min = true, bool include_max = true) {
+    GRID_INDEX_STATS(GridQueryStatsRecorder stats;)
+    result.clear();
+    int i_min, i_max, j_min, j_max;
+    grid.get_box_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max,
+                            include_min, include_max);
+    // Open edges on cell boundaries can leave no cells
+    if (i_min > i_max || j_min > j_max) {
+        GRID_INDEX_STATS(stats.emit(0);)
+        co_return;
+    }
+
+    for (int j = j_min; j <= j_max; ++j) {
+        // The row's cell headers are contiguous: fetch them first, then the
+        // index lists they point to, then read
+        const std::vector<size_t>* row = &grid.get_cell(i_min, j);
+        const int width = i_max - i_min + 1;
+        prefetch(row, width * sizeof(*row));
+        co_await std::suspend_always{};
+
+        bool any = false;
+        for (int k = 0; k < width; ++k) {
+            GRID_INDEX_STATS(stats.cell(row[k].size());)
+            if (row[k].empty()) continue;
+            prefetch(row[k].data(), row[k].size() * sizeof(size_t));
+            any = true;
+        }
+        if (!any) continue;
+        co_await std::suspend_always{};
+
+        for (int k = 0; k < width; ++k) {
+            result.insert(result.end(), row[k].begin(), row[k].end());
+        }
+    }
+    GRID_INDEX_STATS(stats.emit(result.size());)
+}
+
+/**
+ * @brief Single-threaded round-robin executor for query tasks
+ *
+ * Keeps up to width tasks in flight and resumes each in turn; a finished
+ * task is replaced by the next one. The width should cover the latency
+ * being hidden: a few tasks for cache misses, more for page faults served
+ * by read-ahead.
+ */
+class GridInterleavedExecutor {
+public:
+    explicit GridInterleavedExecutor(size_t width = 8) : width_(width ? width : 1) {}
+
+    /** @brief Queue a task; it first runs inside run() */
+    void spawn(GridQueryTask task) {
+        queued_.push_back(std::move(task));
+    }
+
+    /**
+     * @brief Run all queued tasks to completion
+     * @throws The first exception thrown by a task; the remaining tasks are dropped
+     */
+    void run() {
+        try {
+            run(queued_.size(), [this](size_t) {
+                GridQueryTask task = std::move(queued_.front());
+                queued_.pop_front();
+                return task;
+            });
+        } catch (...) {
+            queued_.clear();
+            throw;
+        }
+    }
+
+    /**
+     * @brief Run count tasks created on demand by make_task(0), ..., make_task(count - 1)
+     *
+     * Tasks are created only when a slot frees up, so at most width
+     * coroutine frames exist at a time however long the batch is.
+     *
+     * @throws The first exception thrown by a task; the remaining tasks are dropped
+     */
+    template<typename MakeTask>
+    void run(size_t count, MakeTask make_task) {
+        active_.clear();
+        size_t next = 0;
+        try {
+            while (active_.size() < width_ && next < count) {
+                active_.push_back(make_task(next++));
+            }
+            while (!active_.empty()) {
+                for (size_t k = 0; k < active_.size();) {
+                    active_[k].resume();
+                    if (!active_[k].done()) {
+                        ++k;
+                    } else if (next < count) {
+                        // Refill the slot right away so the round keeps its width
+                        active_[k++] = make_task(next++);
+                    } else {
+                        active_[k] = std::move(active_.back());
+                        active_.pop_back();
+                    }
+                }
+            }
+        } catch (...) {
+            active_.clear();
+            throw;
+        }
+    }
+
+    size_t width() const { return width_; }
+
+private:
+    size_t width_;
+    std::deque<GridQueryTask> queued_;
+    std::vector<GridQueryTask> active_;
+};
+
+/**
+ * @brief Run a batch of box queries interleaved
+ *
+ * @param grid Grid to query
+ * @param boxes Query boxes
+ * @param results Receives one index list per box, each as query_box_no_alloc()
+ * @param width Number of queries in flight
+ * @param prefetch Hook called before each memory range is read
+ * @param include_min Include lower edges (default: true)
+ * @param include_max Include upper edges (default: true)
+ */
+template<typename T>
+void query_boxes_interleaved(const GridIndex2D<T>& grid, const std::vector<GridBox<T>>& boxes,
+                             std::vector<std::vector<size_t>>& results, size_t width = 8,
+                             GridPrefetchHook prefetch = grid_prefetch_cache,
+                             bool include_min = true, bool include_max = true) {
+    results.resize(boxes.size());
+    GridInterleavedExecutor executor(width);
+    executor.run(boxes.size(), [&](size_t b) {
+        return async_query_box(grid, boxes[b].x1, boxes[b].x2, boxes[b].y1, boxes[b].y2,
+                               results[b], prefetch, include_min, include_max);
+    });
+}
+
+#endif // GRID_INDEX_ASYNC_H
@@ -0,0 +1,120 @@
+/**
+ * @file grid_index_c.h
+ * @brief C API of the grid index (libgrid_index_c)
+ *
+ * Stable C interface for callers that cannot use the C++ template
+ * (Fortran via ISO_C_BINDING, Python via ctypes/cffi, ...). Grids are
+ * opaque handles, one type per coordinate type. Functions never throw:
+ * they return a grid_index_status, and grid_index_last_error() describes
+ * the last failure on the calling thread.
+ *
+ * Query results are written to caller-owned buffers as int64_t point
+ * indices; nothing is allocated per query. When a buffer is too small
+ * the call fills it, still reports the full count and returns
+ * GRID_INDEX_ERROR_BUFFER_TOO_SMALL, so callers can size the buffer from
+ * the count and repeat the call.
+ *
+ * @copyright MIT License
+ */
+
+#ifndef GRID_INDEX_C_H
+#define GRID_INDEX_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(GRID_INDEX_C_BUILD)
+#define GRID_INDEX_C_API __declspec(dllexport)
+#else
+#define GRID_INDEX_C_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+#define GRID_INDEX_C_API __attribute__((visibility("default")))
+#else
+#define GRID_INDEX_C_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Version of this API; bumped on incompatible changes */
+#define GRID_INDEX_C_API_VERSION 1
+
+typedef enum grid_index_status {
+    GRID_INDEX_OK = 0,
+    GRID_INDEX_ERROR_INVALID_ARGUMENT = 1,  /* Bad grid parameters or null pointers */
+    GRID_INDEX_ERROR_OUT_OF_MEMORY = 2,
+    GRID_INDEX_ERROR_BUFFER_TOO_SMALL = 3,  /* Output truncated; counts are complete */
+    GRID_INDEX_ERROR_INTERNAL = 4
+} grid_index_status;
+
+/** @brief Grid over float coordinates (GridIndex2D<float>) */
+typedef struct grid_index_f32 grid_index_f32;
+/** @brief Grid over double coordinates (GridIndex2D<double>) */
+typedef struct grid_index_f64 grid_index_f64;
+
+/** @brief GRID_INDEX_C_API_VERSION of the loaded library */
+GRID_INDEX_C_API int grid_index_api_version(void);
+
+/** @brief Message for the last failed call on this thread ("" if none) */
+GRID_INDEX_C_API const char* grid_index_last_error(void);
+
+/*
+ * Per coordinate type (f32: float, f64: double):
+ *
+ * create         New empty grid; *out receives the handle
+ * free           Release a grid (null is ignored)
+ * insert_points  Insert n points; point k gets index first_index + k
+ * clear          Remove all points, keep the cell structure
+ * num_points     Number of stored indices (0 for null)
+ * query_box      Indices of one box into out[capacity]; *count = full count
+ * query_boxes    Batch query in CSR form: boxes holds n_boxes * 4 values
+ *                (x1, x2, y1, y2), the indices of box b are written to
+ *                indices[offsets[b] .. offsets[b + 1]), offsets has
+ *                n_boxes + 1 entries and *total = offsets[n_boxes]. Offsets
+ *                always describe the full result, also when indices was too
+ *                small.
+ *
+ * include_min / include_max (0 or 1) select open or closed box edges, as in
+ * GridIndex2D::query_box(): 1, 1 gives [x1, x2] x [y1, y2].
+ */
+
+GRID_INDEX_C_API grid_index_status grid_index_f32_create(
+    float x_start, float x_end, float x_step,
+    float y_start, float y_end, float y_step, grid_index_f32** out);
+GRID_INDEX_C_API void grid_index_f32_free(grid_index_f32* grid);
+GRID_INDEX_C_API grid_index_status grid_index_f32_insert_points(
+    grid_index_f32* grid, const float* xs, const float* ys, size_t n, int64_t first_index);
+GRID_INDEX_C_API grid_index_status grid_index_f32_clear(grid_index_f32* grid);
+GRID_INDEX_C_API size_t grid_index_f32_num_points(const grid_index_f32* grid);
+GRID_INDEX_C_API grid_index_status grid_index_f32_query_box(
+    const grid_index_f32* grid, float x1, float x2, float y1, float y2,
+    int include_min, int include_max, int64_t* out, size_t capacity, size_t* count);
+GRID_INDEX_C_API grid_index_status grid_index_f32_query_boxes(
+    const grid_index_f32* grid, const float* boxes, size_t n_boxes,
+    int include_min, int include_max,
+    int64_t* offsets, int64_t* indices, size_t capacity, size_t* total);
+
+GRID_INDEX_C_API grid_index_status grid_index_f64_create(
+    double x_start, double x_end, double x_step,
+    double y_start, double y_end, double y_step, grid_index_f64** out);
+GRID_INDEX_C_API void grid_index_f64_free(grid_index_f64* grid);
+GRID_INDEX_C_API grid_index_status grid_index_f64_insert_points(
+    grid_index_f64* grid, const double* xs, const double* ys, size_t n, int64_t first_index);
+GRID_INDEX_C_API grid_index_status grid_index_f64_clear(grid_index_f64* grid);
+GRID_INDEX_C_API size_t grid_index_f64_num_points(const grid_index_f64* grid);
+GRID_INDEX_C_API grid_index_status grid_index_f64_query_box(
+    const grid_index_f64* grid, double x1, double x2, double y1, double y2,
+    int include_min, int include_max, int64_t* out, size_t capacity, size_t* count);
+GRID_INDEX_C_API grid_index_status grid_index_f64_query_boxes(
+    const grid_index_f64* grid, const double* boxes, size_t n_boxes,
+    int include_min, int include_max,
+    int64_t* offsets, int64_t* indices, size_t capacity, size_t* total);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GRID_INDEX_C_H */
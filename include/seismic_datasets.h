@@ -0,0 +1,539 @@
+/**
+ * @file seismic_datasets.h
+ * @brief Deterministic synthetic seismic acquisition geometries
+ *
+ * Generators produce CMP midpoints ((source + receiver) / 2) for common
+ * acquisition layouts:
+ * - LandOrthogonalGenerator: orthogonal source/receiver lines with a rolling
+ *   patch and obstacle skids (holes and dense rims)
+ * - MarineStreamerGenerator: towed streamers with slowly varying feathering
+ * - ObnPatchGenerator: ocean-bottom node patches shot with a source carpet,
+ *   overlapping patches giving infill-like density
+ * - Crooked2DGenerator: crooked 2D lines with acquisition gaps
+ *
+ * Every point is a pure function of (seed, point index): noise comes from a
+ * counter-based hash rather than a sequential RNG. A dataset smaller than
+ * one full survey is a stratified random subsample of its traces, so the
+ * coverage pattern is representative at any size; a larger one repeats the
+ * survey with fresh positioning noise. Any range of points can therefore be
+ * generated independently and in any order, and datasets of billions of
+ * points are streamed in fixed-size chunks via for_each_chunk() without ever
+ * being materialized.
+ *
+ * Example:
+ * @code
+ * seismic::LandOrthogonalGenerator<float> land(1000000000ULL, 42);
+ * GridIndex2D<float> grid(...land.bounds()...);
+ * land.for_each_chunk(1 << 20, [&](const float* xs, const float* ys,
+ *                                  size_t n, uint64_t first) {
+ *     for (size_t k = 0; k < n; ++k) grid.insert(xs[k], ys[k], first + k);
+ * });
+ * @endcode
+ */
+
+#ifndef GRID_INDEX_SEISMIC_DATASETS_H
+#define GRID_INDEX_SEISMIC_DATASETS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace seismic {
+
+/**
+ * @brief Axis-aligned extent of a dataset
+ */
+struct Bounds {
+    double x_min, x_max, y_min, y_max;
+};
+
+namespace detail {
+
+const double PI = 3.14159265358979323846;
+
+/** @brief SplitMix64 finalizer: a high quality 64-bit mix */
+inline uint64_t mix64(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/** @brief Counter-based uniform in [0, 1) for (seed, index, stream) */
+inline double uniform(uint64_t seed, uint64_t index, uint64_t stream) {
+    uint64_t h = mix64(seed ^ mix64(index * 0x100000001B3ULL + stream));
+    return static_cast<double>(h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** @brief Counter-based standard normal (Box-Muller) */
+inline double normal(uint64_t seed, uint64_t index, uint64_t stream) {
+    double u1 = uniform(seed, index, stream * 2 + 1);
+    double u2 = uniform(seed, index, stream * 2 + 2);
+    if (u1 < 1e-300) u1 = 1e-300;
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * PI * u2);
+}
+
+} // namespace detail
+
+/**
+ * @brief Shared chunked streaming interface (CRTP)
+ *
+ * Derived classes provide `void point(uint64_t i, double& x, double& y) const`,
+ * `uint64_t survey_size() const` (traces in one full pass of the survey) and
+ * `Bounds bounds() const`.
+ */
+template<typename Derived, typename T>
+class GeneratorBase {
+public:
+    GeneratorBase(uint64_t num_points, uint64_t seed)
+        : num_points_(num_points), seed_(seed) {}
+
+    /** @brief Number of points in the dataset */
+    uint64_t size() const { return num_points_; }
+
+    /**
+     * @brief Generate points [first, first + count) into caller buffers
+     */
+    void generate(uint64_t first, size_t count, T* xs, T* ys) const {
+        const Derived& self = static_cast<const Derived&>(*this);
+        for (size_t k = 0; k < count; ++k) {
+            double x, y;
+            self.point(first + k, x, y);
+            xs[k] = static_cast<T>(x);
+            ys[k] = static_cast<T>(y);
+        }
+    }
+
+    /**
+     * @brief Stream the whole dataset through a fixed-size buffer
+     *
+     * @param chunk_size Points per chunk (buffer memory is 2 * chunk_size * sizeof(T))
+     * @param fn Called as fn(const T* xs, const T* ys, size_t n, uint64_t first_index)
+     * @throws std::invalid_argument if chunk_size is 0
+     */
+    template<typename Fn>
+    void for_each_chunk(size_t chunk_size, Fn fn) const {
+        if (chunk_size == 0) {
+            throw std::invalid_argument("Chunk size must be positive");
+        }
+        const uint64_t total = num_points_;
+        std::vector<T> xs(chunk_size), ys(chunk_size);
+        for (uint64_t first = 0; first < total; first += chunk_size) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(chunk_size, total - first));
+            generate(first, n, xs.data(), ys.data());
+            fn(xs.data(), ys.data(), n, first);
+        }
+    }
+
+    /**
+     * @brief Materialize all points (only for datasets that fit in memory)
+     */
+    void materialize(std::vector<T>& xs, std::vector<T>& ys) const {
+        const size_t n = static_cast<size_t>(num_points_);
+        xs.resize(n);
+        ys.resize(n);
+        generate(0, n, xs.data(), ys.data());
+    }
+
+protected:
+    uint64_t num_points_;
+    uint64_t seed_;
+
+    /**
+     * @brief Map a point index to a trace of the full survey
+     *
+     * Below one survey pass, point i draws a random trace from the i-th of
+     * num_points equal strata of the survey.
+     */
+    uint64_t survey_trace(uint64_t i) const {
+        const uint64_t survey = static_cast<const Derived&>(*this).survey_size();
+        if (num_points_ >= survey) return i % survey;
+        const double ratio = static_cast<double>(survey) / static_cast<double>(num_points_);
+        const double u = detail::uniform(seed_, i, 7);
+        uint64_t t = static_cast<uint64_t>((static_cast<double>(i) + u) * ratio);
+        return std::min(t, survey - 1);
+    }
+};
+
+/**
+ * @brief Orthogonal land geometry with a rolling patch
+ *
+ * Receiver lines run along x, source lines along y. Each shot records a
+ * patch of `patch_lines` receiver lines by `patch_channels` channels centred
+ * on the shot (shifted inwards at the survey edges). Shots falling into an
+ * obstacle are skidded radially to its rim, leaving a midpoint hole with a
+ * dense border.
+ */
+template<typename T>
+class LandOrthogonalGenerator : public GeneratorBase<LandOrthogonalGenerator<T>, T> {
+public:
+    struct Params {
+        double receiver_line_spacing = 200.0;
+        double receiver_interval = 25.0;
+        int num_receiver_lines = 40;
+        int receivers_per_line = 320;
+        double source_line_spacing = 200.0;
+        double source_interval = 25.0;
+        int num_source_lines = 40;
+        int sources_per_line = 320;
+        int patch_lines = 10;
+        int patch_channels = 160;
+        int num_obstacles = 3;
+        double obstacle_radius = 300.0;
+        double position_noise = 1.0;  // Standard deviation in metres
+    };
+
+    LandOrthogonalGenerator(uint64_t num_points, uint64_t seed, const Params& p = Params())
+        : GeneratorBase<LandOrthogonalGenerator<T>, T>(num_points, seed), p_(p)
+    {
+        width_ = (p_.receivers_per_line - 1) * p_.receiver_interval;
+        height_ = (p_.num_receiver_lines - 1) * p_.receiver_line_spacing;
+        for (int k = 0; k < p_.num_obstacles; ++k) {
+            obstacle_x_.push_back(detail::uniform(this->seed_, k, 101) * width_);
+            obstacle_y_.push_back(detail::uniform(this->seed_, k, 102) * height_);
+        }
+    }
+
+    /** @brief Traces in one full pass of the survey */
+    uint64_t survey_size() const {
+        return static_cast<uint64_t>(p_.num_source_lines) * p_.sources_per_line *
+               p_.patch_lines * p_.patch_channels;
+    }
+
+    /** @brief Natural CMP bin size (half the receiver interval) */
+    double bin_size() const { return 0.5 * p_.receiver_interval; }
+
+    Bounds bounds() const {
+        const double m = 4.0 * p_.position_noise + p_.obstacle_radius;
+        Bounds b = {-m, width_ + m, -m, height_ + m};
+        return b;
+    }
+
+    void point(uint64_t i, double& x, double& y) const {
+        const uint64_t traces_per_shot = static_cast<uint64_t>(p_.patch_lines) * p_.patch_channels;
+        const uint64_t num_shots = static_cast<uint64_t>(p_.num_source_lines) * p_.sources_per_line;
+        const uint64_t t = this->survey_trace(i);
+        const uint64_t shot = (t / traces_per_shot) % num_shots;
+        const uint64_t trace = t % traces_per_shot;
+
+        // Source position along its line, skidded out of obstacles
+        const int source_line = static_cast<int>(shot / p_.sources_per_line);
+        const int station = static_cast<int>(shot % p_.sources_per_line);
+        double sx = (source_line + 0.5) * p_.source_line_spacing;
+        double sy = station * p_.source_interval;
+        skid(sx, sy);
+
+        // Patch centred on the shot, clamped into the receiver spread
+        int line0 = static_cast<int>(std::floor(sy / p_.receiver_line_spacing + 0.5)) - p_.patch_lines / 2;
+        line0 = std::max(0, std::min(line0, p_.num_receiver_lines - p_.patch_lines));
+        int chan0 = static_cast<int>(std::floor(sx / p_.receiver_interval + 0.5)) - p_.patch_channels / 2;
+        chan0 = std::max(0, std::min(chan0, p_.receivers_per_line - p_.patch_channels));
+        const int line = line0 + static_cast<int>(trace / p_.patch_channels);
+        const int chan = chan0 + static_cast<int>(trace % p_.patch_channels);
+        const double rx = chan * p_.receiver_interval;
+        const double ry = line * p_.receiver_line_spacing;
+
+        x = 0.5 * (sx + rx) + p_.position_noise * detail::normal(this->seed_, i, 1);
+        y = 0.5 * (sy + ry) + p_.position_noise * detail::normal(this->seed_, i, 2);
+    }
+
+private:
+    Params p_;
+    double width_, height_;
+    std::vector<double> obstacle_x_, obstacle_y_;
+
+    void skid(double& sx, double& sy) const {
+        for (size_t k = 0; k < obstacle_x_.size(); ++k) {
+            double dx = sx - obstacle_x_[k];
+            double dy = sy - obstacle_y_[k];
+            double r = std::sqrt(dx * dx + dy * dy);
+            if (r < p_.obstacle_radius) {
+                if (r < 1e-9) { dx = 1.0; dy = 0.0; r = 1.0; }
+                sx = obstacle_x_[k] + dx / r * p_.obstacle_radius;
+                sy = obstacle_y_[k] + dy / r * p_.obstacle_radius;
+            }
+        }
+    }
+};
+
+/**
+ * @brief Marine towed-streamer geometry with feathering
+ *
+ * Sail lines run along x, alternating direction. Streamers trail the vessel
+ * and are rotated by a feather angle that drifts smoothly along each line
+ * (cross-currents), smearing midpoints across neighbouring bins and leaving
+ * coverage holes between lines where the feather is large.
+ */
+template<typename T>
+class MarineStreamerGenerator : public GeneratorBase<MarineStreamerGenerator<T>, T> {
+public:
+    struct Params {
+        int num_sail_lines = 20;
+        double sail_line_spacing = 400.0;
+        int shots_per_line = 1200;
+        double shot_interval = 25.0;
+        int num_streamers = 10;
+        double streamer_spacing = 100.0;
+        int channels_per_streamer = 480;
+        double channel_spacing = 12.5;
+        double near_offset = 150.0;
+        double max_feather_deg = 8.0;
+        double feather_period = 6000.0;  // Metres of sailing per feather cycle
+        double position_noise = 2.0;
+    };
+
+    MarineStreamerGenerator(uint64_t num_points, uint64_t seed, const Params& p = Params())
+        : GeneratorBase<MarineStreamerGenerator<T>, T>(num_points, seed), p_(p)
+    {
+        line_length_ = (p_.shots_per_line - 1) * p_.shot_interval;
+        cable_length_ = p_.near_offset + (p_.channels_per_streamer - 1) * p_.channel_spacing;
+    }
+
+    uint64_t survey_size() const {
+        return static_cast<uint64_t>(p_.num_sail_lines) * p_.shots_per_line *
+               p_.num_streamers * p_.channels_per_streamer;
+    }
+
+    double bin_size() const { return 0.5 * p_.channel_spacing; }
+
+    Bounds bounds() const {
+        const double spread = 0.5 * (p_.num_streamers - 1) * p_.streamer_spacing;
+        const double m = 0.5 * (cable_length_ + spread) + 4.0 * p_.position_noise;
+        Bounds b = {-m, line_length_ + m, -m,
+                    (p_.num_sail_lines - 1) * p_.sail_line_spacing + m};
+        return b;
+    }
+
+    void point(uint64_t i, double& x, double& y) const {
+        const uint64_t traces_per_shot =
+            static_cast<uint64_t>(p_.num_streamers) * p_.channels_per_streamer;
+        const uint64_t shots_total = static_cast<uint64_t>(p_.num_sail_lines) * p_.shots_per_line;
+        const uint64_t t = this->survey_trace(i);
+        const uint64_t shot = (t / traces_per_shot) % shots_total;
+        const uint64_t trace = t % traces_per_shot;
+        const int line = static_cast<int>(shot / p_.shots_per_line);
+        const int station = static_cast<int>(shot % p_.shots_per_line);
+
+        // Vessel heading alternates between +x and -x
+        const double heading = (line % 2 == 0) ? 1.0 : -1.0;
+        const double along = station * p_.shot_interval;
+        const double sx = heading > 0 ? along : line_length_ - along;
+        const double sy = line * p_.sail_line_spacing;
+
+        // Smooth feather drift with a per-line phase
+        const double phase = 2.0 * detail::PI * detail::uniform(this->seed_, line, 201);
+        const double feather = p_.max_feather_deg * detail::PI / 180.0 *
+            std::sin(2.0 * detail::PI * along / p_.feather_period + phase);
+
+        const int streamer = static_cast<int>(trace / p_.channels_per_streamer);
+        const int channel = static_cast<int>(trace % p_.channels_per_streamer);
+        const double behind = p_.near_offset + channel * p_.channel_spacing;
+        const double cross = (streamer - 0.5 * (p_.num_streamers - 1)) * p_.streamer_spacing;
+
+        // Receiver offset in vessel frame, rotated by the feather angle
+        const double c = std::cos(feather), s = std::sin(feather);
+        const double ox = -behind * heading;
+        const double oy = cross;
+        const double rx = sx + c * ox - s * oy;
+        const double ry = sy + s * ox + c * oy;
+
+        x = 0.5 * (sx + rx) + p_.position_noise * detail::normal(this->seed_, i, 1);
+        y = 0.5 * (sy + ry) + p_.position_noise * detail::normal(this->seed_, i, 2);
+    }
+
+private:
+    Params p_;
+    double line_length_, cable_length_;
+};
+
+/**
+ * @brief Ocean-bottom node patches shot with a dense source carpet
+ *
+ * Each patch is a rectangular grid of nodes; the source carpet covers the
+ * patch plus a halo. Patches are laid out on a coarse grid with overlap, so
+ * overlap regions receive double coverage (infill patches).
+ */
+template<typename T>
+class ObnPatchGenerator : public GeneratorBase<ObnPatchGenerator<T>, T> {
+public:
+    struct Params {
+        int patches_x = 2;
+        int patches_y = 2;
+        double patch_overlap = 0.25;  // Fraction of patch size shared with neighbours
+        int nodes_x = 10;
+        int nodes_y = 10;
+        double node_spacing = 400.0;
+        double source_spacing = 50.0;
+        double source_halo = 2000.0;
+        double position_noise = 3.0;
+    };
+
+    ObnPatchGenerator(uint64_t num_points, uint64_t seed, const Params& p = Params())
+        : GeneratorBase<ObnPatchGenerator<T>, T>(num_points, seed), p_(p)
+    {
+        patch_w_ = (p_.nodes_x - 1) * p_.node_spacing;
+        patch_h_ = (p_.nodes_y - 1) * p_.node_spacing;
+        shots_x_ = static_cast<int>((patch_w_ + 2 * p_.source_halo) / p_.source_spacing) + 1;
+        shots_y_ = static_cast<int>((patch_h_ + 2 * p_.source_halo) / p_.source_spacing) + 1;
+    }
+
+    uint64_t survey_size() const {
+        return static_cast<uint64_t>(p_.patches_x) * p_.patches_y *
+               p_.nodes_x * p_.nodes_y * static_cast<uint64_t>(shots_x_) * shots_y_;
+    }
+
+    double bin_size() const { return 0.5 * p_.source_spacing; }
+
+    Bounds bounds() const {
+        const double m = 0.5 * p_.source_halo + 4.0 * p_.position_noise;
+        Bounds b = {-m, patch_origin(p_.patches_x - 1, patch_w_) + patch_w_ + m,
+                    -m, patch_origin(p_.patches_y - 1, patch_h_) + patch_h_ + m};
+        return b;
+    }
+
+    void point(uint64_t i, double& x, double& y) const {
+        const uint64_t nodes = static_cast<uint64_t>(p_.nodes_x) * p_.nodes_y;
+        const uint64_t per_patch = nodes * static_cast<uint64_t>(shots_x_) * shots_y_;
+        const uint64_t num_patches = static_cast<uint64_t>(p_.patches_x) * p_.patches_y;
+        const uint64_t t = this->survey_trace(i);
+        const uint64_t patch = (t / per_patch) % num_patches;
+        const uint64_t within = t % per_patch;
+        const uint64_t shot = within / nodes;
+        const uint64_t node = within % nodes;
+
+        const double px = patch_origin(static_cast<int>(patch % p_.patches_x), patch_w_);
+        const double py = patch_origin(static_cast<int>(patch / p_.patches_x), patch_h_);
+        const double nx = px + static_cast<double>(node % p_.nodes_x) * p_.node_spacing;
+        const double ny = py + static_cast<double>(node / p_.nodes_x) * p_.node_spacing;
+        const double sx = px - p_.source_halo +
+            static_cast<double>(shot % shots_x_) * p_.source_spacing;
+        const double sy = py - p_.source_halo +
+            static_cast<double>(shot / shots_x_) * p_.source_spacing;
+
+        x = 0.5 * (sx + nx) + p_.position_noise * detail::normal(this->seed_, i, 1);
+        y = 0.5 * (sy + ny) + p_.position_noise * detail::normal(this->seed_, i, 2);
+    }
+
+private:
+    Params p_;
+    double patch_w_, patch_h_;
+    int shots_x_, shots_y_;
+
+    double patch_origin(int k, double extent) const {
+        return k * extent * (1.0 - p_.patch_overlap);
+    }
+};
+
+/**
+ * @brief Crooked 2D lines with acquisition gaps
+ *
+ * Each line follows a smooth random curve of the given length across the
+ * survey area. Shots are spread along the line with a split spread of
+ * receivers; midpoints of curved source-receiver chords scatter off the
+ * line. Each line has one gap (e.g. a river crossing) that shots skip.
+ */
+template<typename T>
+class Crooked2DGenerator : public GeneratorBase<Crooked2DGenerator<T>, T> {
+public:
+    struct Params {
+        int num_lines = 8;
+        double line_length = 20000.0;
+        double area_size = 20000.0;
+        double shot_interval = 50.0;
+        int channels = 240;
+        double channel_spacing = 25.0;
+        double crookedness = 400.0;   // Amplitude of the lateral wiggle in metres
+        double wiggle_length = 5000.0;
+        double gap_length = 1000.0;
+        double position_noise = 1.0;
+    };
+
+    Crooked2DGenerator(uint64_t num_points, uint64_t seed, const Params& p = Params())
+        : GeneratorBase<Crooked2DGenerator<T>, T>(num_points, seed), p_(p)
+    {
+        shots_per_line_ = static_cast<int>((p_.line_length - p_.gap_length) / p_.shot_interval);
+        for (int l = 0; l < p_.num_lines; ++l) {
+            double angle = detail::PI * detail::uniform(this->seed_, l, 301);
+            Line line;
+            line.dx = std::cos(angle);
+            line.dy = std::sin(angle);
+            // Lines pass near the area centre so they cross each other
+            const double cx = p_.area_size * (0.3 + 0.4 * detail::uniform(this->seed_, l, 302));
+            const double cy = p_.area_size * (0.3 + 0.4 * detail::uniform(this->seed_, l, 303));
+            line.x0 = cx - 0.5 * p_.line_length * line.dx;
+            line.y0 = cy - 0.5 * p_.line_length * line.dy;
+            line.phase1 = 2.0 * detail::PI * detail::uniform(this->seed_, l, 304);
+            line.phase2 = 2.0 * detail::PI * detail::uniform(this->seed_, l, 305);
+            line.gap_start = (0.2 + 0.6 * detail::uniform(this->seed_, l, 306)) * p_.line_length;
+            lines_.push_back(line);
+        }
+    }
+
+    uint64_t survey_size() const {
+        return static_cast<uint64_t>(lines_.size()) * shots_per_line_ * p_.channels;
+    }
+
+    double bin_size() const { return 0.5 * p_.channel_spacing; }
+
+    Bounds bounds() const {
+        Bounds b = {1e300, -1e300, 1e300, -1e300};
+        const double m = p_.crookedness * 1.5 + 4.0 * p_.position_noise;
+        for (size_t l = 0; l < lines_.size(); ++l) {
+            const double ex = lines_[l].x0 + p_.line_length * lines_[l].dx;
+            const double ey = lines_[l].y0 + p_.line_length * lines_[l].dy;
+            b.x_min = std::min(b.x_min, std::min(lines_[l].x0, ex) - m);
+            b.x_max = std::max(b.x_max, std::max(lines_[l].x0, ex) + m);
+            b.y_min = std::min(b.y_min, std::min(lines_[l].y0, ey) - m);
+            b.y_max = std::max(b.y_max, std::max(lines_[l].y0, ey) + m);
+        }
+        return b;
+    }
+
+    void point(uint64_t i, double& x, double& y) const {
+        const uint64_t traces_per_line = static_cast<uint64_t>(shots_per_line_) * p_.channels;
+        const uint64_t total = traces_per_line * lines_.size();
+        const uint64_t k = this->survey_trace(i) % total;
+        const Line& line = lines_[static_cast<size_t>(k / traces_per_line)];
+        const uint64_t within = k % traces_per_line;
+        const int shot = static_cast<int>(within / p_.channels);
+        const int channel = static_cast<int>(within % p_.channels);
+
+        // Shots skip the gap; receivers are a split spread around the shot
+        double us = shot * p_.shot_interval;
+        if (us >= line.gap_start) us += p_.gap_length;
+        double ur = us + (channel - 0.5 * (p_.channels - 1)) * p_.channel_spacing;
+        ur = std::max(0.0, std::min(ur, p_.line_length));
+
+        double sx, sy, rx, ry;
+        position(line, us, sx, sy);
+        position(line, ur, rx, ry);
+        x = 0.5 * (sx + rx) + p_.position_noise * detail::normal(this->seed_, i, 1);
+        y = 0.5 * (sy + ry) + p_.position_noise * detail::normal(this->seed_, i, 2);
+    }
+
+private:
+    struct Line {
+        double x0, y0, dx, dy;
+        double phase1, phase2;
+        double gap_start;
+    };
+
+    Params p_;
+    int shots_per_line_;
+    std::vector<Line> lines_;
+
+    void position(const Line& line, double u, double& x, double& y) const {
+        const double w = 2.0 * detail::PI * u / p_.wiggle_length;
+        const double lateral = p_.crookedness *
+            (0.7 * std::sin(w + line.phase1) + 0.3 * std::sin(2.7 * w + line.phase2));
+        x = line.x0 + u * line.dx - lateral * line.dy;
+        y = line.y0 + u * line.dy + lateral * line.dx;
+    }
+};
+
+} // namespace seismic
+
+#endif // GRID_INDEX_SEISMIC_DATASETS_H
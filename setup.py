@@ -0,0 +1,23 @@
+"""
+Build the Python module with pip:  pip install .
+
+The CMake build (-DBUILD_PYTHON=ON) produces the same module.
+"""
+
+from setuptools import Extension, setup
+
+setup(
+    name="grid_index",
+    version="1.0.0",
+    description="Uniform grid spatial index with NumPy-friendly batch queries",
+    license="MIT",
+    ext_modules=[
+        Extension(
+            "grid_index",
+            sources=["src/grid_index_python.cpp"],
+            include_dirs=["include"],
+            extra_compile_args=["-std=c++14", "-O2", "-fvisibility=hidden"],
+            language="c++",
+        )
+    ],
+)
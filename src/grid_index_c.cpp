@@ -0,0 +1,248 @@
+/**
+ * @file grid_index_c.cpp
+ * @brief C API of the grid index, implemented on GridIndex2D
+ *
+ * Every entry point converts C++ exceptions into a status code and a
+ * thread-local error message; nothing propagates across the C boundary.
+ *
+ * @copyright MIT License
+ */
+
+#define GRID_INDEX_C_BUILD
+#include "grid_index_c.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "grid_index.h"
+
+struct grid_index_f32 {
+    GridIndex2D<float> grid;
+    grid_index_f32(float xs, float xe, float xd, float ys, float ye, float yd)
+        : grid(xs, xe, xd, ys, ye, yd) {}
+};
+
+struct grid_index_f64 {
+    GridIndex2D<double> grid;
+    grid_index_f64(double xs, double xe, double xd, double ys, double ye, double yd)
+        : grid(xs, xe, xd, ys, ye, yd) {}
+};
+
+namespace {
+
+std::string& last_error() {
+    static thread_local std::string message;
+    return message;
+}
+
+grid_index_status fail(grid_index_status status, const char* message) {
+    last_error() = message;
+    return status;
+}
+
+/**
+ * @brief Run f, mapping exceptions to status codes
+ */
+template<typename F>
+grid_index_status guarded(F f) {
+    try {
+        return f();
+    } catch (const std::invalid_argument& e) {
+        return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, e.what());
+    } catch (const std::bad_alloc&) {
+        return fail(GRID_INDEX_ERROR_OUT_OF_MEMORY, "out of memory");
+    } catch (const std::exception& e) {
+        return fail(GRID_INDEX_ERROR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(GRID_INDEX_ERROR_INTERNAL, "unknown error");
+    }
+}
+
+template<typename Handle, typename T>
+grid_index_status create(T x_start, T x_end, T x_step, T y_start, T y_end, T y_step,
+                         Handle** out) {
+    if (!out) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "out is null");
+    *out = nullptr;
+    return guarded([&]() -> grid_index_status {
+        *out = new Handle(x_start, x_end, x_step, y_start, y_end, y_step);
+        return GRID_INDEX_OK;
+    });
+}
+
+template<typename Handle, typename T>
+grid_index_status insert_points(Handle* handle, const T* xs, const T* ys, size_t n,
+                                int64_t first_index) {
+    if (!handle) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "grid is null");
+    if (n > 0 && (!xs || !ys)) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "xs or ys is null");
+    if (first_index < 0) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "first_index is negative");
+    return guarded([&]() -> grid_index_status {
+        handle->grid.insert_points(xs, ys, n, static_cast<size_t>(first_index));
+        return GRID_INDEX_OK;
+    });
+}
+
+/**
+ * @brief Append the indices of one box to out[pos, capacity), counting past the end
+ *
+ * Goes through query_box_no_alloc() into a per-thread buffer. The copy
+ * into the caller's buffer is then a memcpy (with 64-bit size_t), much
+ * cheaper than a per-index callback, and the query keeps its
+ * prefetching and hooks.
+ */
+template<typename T>
+void collect_box(const GridIndex2D<T>& grid, T x1, T x2, T y1, T y2, bool include_min,
+                 bool include_max, int64_t* out, size_t capacity, size_t& pos) {
+    static thread_local std::vector<size_t> buffer;
+    grid.query_box_no_alloc(x1, x2, y1, y2, buffer, false, include_min, include_max);
+    if (pos < capacity) {
+        const size_t n = std::min(buffer.size(), capacity - pos);
+        if (sizeof(size_t) == sizeof(int64_t)) {
+            std::memcpy(out + pos, buffer.data(), n * sizeof(int64_t));
+        } else {
+            std::copy(buffer.begin(), buffer.begin() + n, out + pos);
+        }
+    }
+    pos += buffer.size();
+}
+
+template<typename Handle, typename T>
+grid_index_status query_box(const Handle* handle, T x1, T x2, T y1, T y2,
+                            int include_min, int include_max,
+                            int64_t* out, size_t capacity, size_t* count) {
+    if (!handle || !count) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "grid or count is null");
+    if (capacity > 0 && !out) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "out is null");
+    *count = 0;
+    return guarded([&]() -> grid_index_status {
+        size_t pos = 0;
+        collect_box(handle->grid, x1, x2, y1, y2, include_min != 0, include_max != 0,
+                    out, capacity, pos);
+        *count = pos;
+        if (pos > capacity) {
+            return fail(GRID_INDEX_ERROR_BUFFER_TOO_SMALL, "output buffer too small");
+        }
+        return GRID_INDEX_OK;
+    });
+}
+
+template<typename Handle, typename T>
+grid_index_status query_boxes(const Handle* handle, const T* boxes, size_t n_boxes,
+                              int include_min, int include_max,
+                              int64_t* offsets, int64_t* indices, size_t capacity,
+                              size_t* total) {
+    if (!handle || !offsets || !total) {
+        return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "grid, offsets or total is null");
+    }
+    if (n_boxes > 0 && !boxes) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "boxes is null");
+    if (capacity > 0 && !indices) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "indices is null");
+    *total = 0;
+    return guarded([&]() -> grid_index_status {
+        size_t pos = 0;
+        offsets[0] = 0;
+        for (size_t b = 0; b < n_boxes; ++b) {
+            const T* box = boxes + 4 * b;
+            collect_box(handle->grid, box[0], box[1], box[2], box[3],
+                        include_min != 0, include_max != 0, indices, capacity, pos);
+            offsets[b + 1] = static_cast<int64_t>(pos);
+        }
+        *total = pos;
+        if (pos > capacity) {
+            return fail(GRID_INDEX_ERROR_BUFFER_TOO_SMALL, "indices buffer too small");
+        }
+        return GRID_INDEX_OK;
+    });
+}
+
+} // namespace
+
+extern "C" {
+
+int grid_index_api_version(void) {
+    return GRID_INDEX_C_API_VERSION;
+}
+
+const char* grid_index_last_error(void) {
+    return last_error().c_str();
+}
+
+grid_index_status grid_index_f32_create(float x_start, float x_end, float x_step,
+                                        float y_start, float y_end, float y_step,
+                                        grid_index_f32** out) {
+    return create(x_start, x_end, x_step, y_start, y_end, y_step, out);
+}
+
+void grid_index_f32_free(grid_index_f32* grid) {
+    delete grid;
+}
+
+grid_index_status grid_index_f32_insert_points(grid_index_f32* grid, const float* xs,
+                                               const float* ys, size_t n, int64_t first_index) {
+    return insert_points(grid, xs, ys, n, first_index);
+}
+
+grid_index_status grid_index_f32_clear(grid_index_f32* grid) {
+    if (!grid) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "grid is null");
+    grid->grid.clear();
+    return GRID_INDEX_OK;
+}
+
+size_t grid_index_f32_num_points(const grid_index_f32* grid) {
+    return grid ? grid->grid.get_num_points() : 0;
+}
+
+grid_index_status grid_index_f32_query_box(const grid_index_f32* grid, float x1, float x2,
+                                           float y1, float y2, int include_min, int include_max,
+                                           int64_t* out, size_t capacity, size_t* count) {
+    return query_box(grid, x1, x2, y1, y2, include_min, include_max, out, capacity, count);
+}
+
+grid_index_status grid_index_f32_query_boxes(const grid_index_f32* grid, const float* boxes,
+                                             size_t n_boxes, int include_min, int include_max,
+                                             int64_t* offsets, int64_t* indices,
+                                             size_t capacity, size_t* total) {
+    return query_boxes(grid, boxes, n_boxes, include_min, include_max,
+                       offsets, indices, capacity, total);
+}
+
+grid_index_status grid_index_f64_create(double x_start, double x_end, double x_step,
+                                        double y_start, double y_end, double y_step,
+                                        grid_index_f64** out) {
+    return create(x_start, x_end, x_step, y_start, y_end, y_step, out);
+}
+
+void grid_index_f64_free(grid_index_f64* grid) {
+    delete grid;
+}
+
+grid_index_status grid_index_f64_insert_points(grid_index_f64* grid, const double* xs,
+                                               const double* ys, size_t n, int64_t first_index) {
+    return insert_points(grid, xs, ys, n, first_index);
+}
+
+grid_index_status grid_index_f64_clear(grid_index_f64* grid) {
+    if (!grid) return fail(GRID_INDEX_ERROR_INVALID_ARGUMENT, "grid is null");
+    grid->grid.clear();
+    return GRID_INDEX_OK;
+}
+
+size_t grid_index_f64_num_points(const grid_index_f64* grid) {
+    return grid ? grid->grid.get_num_points() : 0;
+}
+
+grid_index_status grid_index_f64_query_box(const grid_index_f64* grid, double x1, double x2,
+                                           double y1, double y2, int include_min, int include_max,
+                                           int64_t* out, size_t capacity, size_t* count) {
+    return query_box(grid, x1, x2, y1, y2, include_min, include_max, out, capacity, count);
+}
+
+grid_index_status grid_index_f64_query_boxes(const grid_index_f64* grid, const double* boxes,
+                                             size_t n_boxes, int include_min, int include_max,
+                                             int64_t* offsets, int64_t* indices,
+                                             size_t capacity, size_t* total) {
+    return query_boxes(grid, boxes, n_boxes, include_min, include_max,
+                       offsets, indices, capacity, total);
+}
+
+} // extern "C"
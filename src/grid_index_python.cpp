@@ -0,0 +1,568 @@
+/**
+ * @file grid_index_python.cpp
+ * @brief Python extension module "grid_index", implemented on GridIndex2D
+ *
+ * Coordinates and query boxes are read in place through the buffer
+ * protocol (NumPy arrays, array.array, memoryview, ...), so building an
+ * index copies no coordinates. Results come back as int64 memoryviews over
+ * storage owned by the module; numpy.asarray() wraps them without a copy.
+ * Inserts, batch queries and large single queries run with the GIL
+ * released.
+ *
+ * @copyright MIT License
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "grid_index.h"
+
+namespace {
+
+// Single queries spanning more cells than this release the GIL; below it,
+// releasing and re-taking the GIL would cost more than the query
+const int GIL_RELEASE_CELLS = 64;
+
+PyTypeObject* index_array_type = nullptr;
+PyTypeObject* grid_index_type = nullptr;
+
+/**
+ * @brief Owner of a query result, exported as a 1-d int64 buffer
+ *
+ * The storage is left uninitialized until the query writes it: zero-filling
+ * a large batch result first costs about a quarter of the batch query.
+ */
+struct IndexArrayObject {
+    PyObject_HEAD
+    int64_t* data;
+    Py_ssize_t shape;
+};
+
+/**
+ * @brief Allocate storage for n indices; only before the array is exported
+ * @throws std::bad_alloc
+ */
+int64_t* allocate(IndexArrayObject* array, size_t n) {
+    delete[] array->data;
+    array->data = nullptr;
+    array->data = new int64_t[n ? n : 1];  // Non-null buffer address when empty
+    array->shape = static_cast<Py_ssize_t>(n);
+    return array->data;
+}
+
+void IndexArray_dealloc(IndexArrayObject* self) {
+    PyTypeObject* type = Py_TYPE(self);
+    delete[] self->data;
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+int IndexArray_getbuffer(IndexArrayObject* self, Py_buffer* view, int flags) {
+    view->obj = reinterpret_cast<PyObject*>(self);
+    Py_INCREF(self);
+    view->buf = self->data;
+    view->len = self->shape * static_cast<Py_ssize_t>(sizeof(int64_t));
+    view->readonly = 0;
+    view->itemsize = sizeof(int64_t);
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>("q") : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? &self->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) ? &view->itemsize : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+PyType_Slot index_array_slots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void*>(IndexArray_dealloc)},
+    {Py_bf_getbuffer, reinterpret_cast<void*>(IndexArray_getbuffer)},
+    {0, nullptr}
+};
+
+PyType_Spec index_array_spec = {
+    "grid_index._IndexArray", sizeof(IndexArrayObject), 0, Py_TPFLAGS_DEFAULT,
+    index_array_slots
+};
+
+IndexArrayObject* new_index_array() {
+    IndexArrayObject* array = PyObject_New(IndexArrayObject, index_array_type);
+    if (!array) return nullptr;
+    array->data = nullptr;
+    array->shape = 0;
+    return array;
+}
+
+/**
+ * @brief Wrap a filled result in a memoryview; steals the reference to array
+ */
+PyObject* as_memoryview(IndexArrayObject* array) {
+    PyObject* view = PyMemoryView_FromObject(reinterpret_cast<PyObject*>(array));
+    Py_DECREF(array);
+    return view;
+}
+
+/**
+ * @brief Buffer view released on scope exit
+ */
+struct BufferGuard {
+    Py_buffer view;
+    bool held;
+    BufferGuard() : held(false) {}
+    ~BufferGuard() {
+        if (held) PyBuffer_Release(&view);
+    }
+};
+
+template<typename T> const char* dtype_name();
+template<> const char* dtype_name<float>() { return "float32"; }
+template<> const char* dtype_name<double>() { return "float64"; }
+
+template<typename T>
+bool format_matches(const char* format) {
+    if (!format) return false;
+#if PY_LITTLE_ENDIAN
+    if (*format == '@' || *format == '=' || *format == '<') ++format;
+#else
+    if (*format == '@' || *format == '=' || *format == '>' || *format == '!') ++format;
+#endif
+    const char expected = sizeof(T) == sizeof(float) ? 'f' : 'd';
+    return format[0] == expected && format[1] == '\0';
+}
+
+/**
+ * @brief Read obj in place as a C-contiguous buffer of T
+ */
+template<typename T>
+bool get_buffer(PyObject* obj, BufferGuard& guard, const char* name) {
+    if (PyObject_GetBuffer(obj, &guard.view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        return false;
+    }
+    guard.held = true;
+    if (guard.view.itemsize != static_cast<Py_ssize_t>(sizeof(T)) ||
+        !format_matches<T>(guard.view.format)) {
+        PyErr_Format(PyExc_TypeError, "%s must be a contiguous %s buffer", name, dtype_name<T>());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Run f with the GIL released; C++ exceptions become Python exceptions
+ */
+template<typename F>
+bool run_without_gil(F f) {
+    PyObject* error_type = nullptr;
+    std::string message;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        f();
+    } catch (const std::bad_alloc&) {
+        error_type = PyExc_MemoryError;
+    } catch (const std::invalid_argument& e) {
+        error_type = PyExc_ValueError;
+        message = e.what();
+    } catch (const std::exception& e) {
+        error_type = PyExc_RuntimeError;
+        message = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error_type) return true;
+    if (error_type == PyExc_MemoryError) {
+        PyErr_NoMemory();
+    } else {
+        PyErr_SetString(error_type, message.c_str());
+    }
+    return false;
+}
+
+/**
+ * @brief GridIndex2D<float> or GridIndex2D<double>, chosen by dtype
+ *
+ * Queries hold the lock shared and inserts exclusively, so threads may
+ * query one grid concurrently while another thread appends to it.
+ */
+struct GridIndexObject {
+    PyObject_HEAD
+    GridIndex2D<float>* grid32;
+    GridIndex2D<double>* grid64;
+    std::shared_timed_mutex* lock;
+};
+
+GridIndex2D<float>& grid_of(GridIndexObject* self, float) { return *self->grid32; }
+GridIndex2D<double>& grid_of(GridIndexObject* self, double) { return *self->grid64; }
+
+/**
+ * @brief Shared lock for a query made with the GIL held
+ *
+ * Waits without the GIL if an insert is running, so other threads keep
+ * going meanwhile.
+ */
+void lock_shared_with_gil(GridIndexObject* self) {
+    if (self->lock->try_lock_shared()) return;
+    Py_BEGIN_ALLOW_THREADS
+    self->lock->lock_shared();
+    Py_END_ALLOW_THREADS
+}
+
+void GridIndex_dealloc(GridIndexObject* self) {
+    PyTypeObject* type = Py_TYPE(self);
+    delete self->grid32;
+    delete self->grid64;
+    delete self->lock;
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+int GridIndex_init(GridIndexObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"x_start", "x_end", "x_step", "y_start", "y_end", "y_step",
+                                     "dtype", nullptr};
+    double xs, xe, xd, ys, ye, yd;
+    const char* dtype = "float64";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "dddddd|s", const_cast<char**>(keywords),
+                                     &xs, &xe, &xd, &ys, &ye, &yd, &dtype)) {
+        return -1;
+    }
+    const std::string type(dtype);
+    if (type != "float32" && type != "float64") {
+        PyErr_SetString(PyExc_ValueError, "dtype must be 'float32' or 'float64'");
+        return -1;
+    }
+    if (self->lock) {
+        PyErr_SetString(PyExc_RuntimeError, "GridIndex is already initialized");
+        return -1;
+    }
+    try {
+        if (type == "float32") {
+            self->grid32 = new GridIndex2D<float>(static_cast<float>(xs), static_cast<float>(xe),
+                                                  static_cast<float>(xd), static_cast<float>(ys),
+                                                  static_cast<float>(ye), static_cast<float>(yd));
+        } else {
+            self->grid64 = new GridIndex2D<double>(xs, xe, xd, ys, ye, yd);
+        }
+        self->lock = new std::shared_timed_mutex();
+    } catch (const std::invalid_argument& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return -1;
+    } catch (const std::bad_alloc&) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    return 0;
+}
+
+bool check_initialized(GridIndexObject* self) {
+    if (self->lock) return true;
+    PyErr_SetString(PyExc_RuntimeError, "GridIndex is not initialized");
+    return false;
+}
+
+template<typename T>
+PyObject* insert_points_impl(GridIndexObject* self, PyObject* xs_obj, PyObject* ys_obj,
+                             Py_ssize_t first_index) {
+    BufferGuard xs, ys;
+    if (!get_buffer<T>(xs_obj, xs, "xs") || !get_buffer<T>(ys_obj, ys, "ys")) return nullptr;
+    const size_t n = static_cast<size_t>(xs.view.len) / sizeof(T);
+    if (static_cast<size_t>(ys.view.len) / sizeof(T) != n) {
+        PyErr_SetString(PyExc_ValueError, "xs and ys must have the same length");
+        return nullptr;
+    }
+    GridIndex2D<T>& grid = grid_of(self, T());
+    const T* x = static_cast<const T*>(xs.view.buf);
+    const T* y = static_cast<const T*>(ys.view.buf);
+    std::shared_timed_mutex& lock = *self->lock;
+    if (!run_without_gil([&]() {
+            std::unique_lock<std::shared_timed_mutex> guard(lock);
+            grid.insert_points(x, y, n, static_cast<size_t>(first_index));
+        })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* GridIndex_insert_points(GridIndexObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"xs", "ys", "first_index", nullptr};
+    PyObject* xs;
+    PyObject* ys;
+    Py_ssize_t first_index = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|n", const_cast<char**>(keywords),
+                                     &xs, &ys, &first_index)) {
+        return nullptr;
+    }
+    if (!check_initialized(self)) return nullptr;
+    if (first_index < 0) {
+        PyErr_SetString(PyExc_ValueError, "first_index must not be negative");
+        return nullptr;
+    }
+    return self->grid32 ? insert_points_impl<float>(self, xs, ys, first_index)
+                        : insert_points_impl<double>(self, xs, ys, first_index);
+}
+
+/**
+ * @brief Indices of one box, in a per-thread buffer reused across queries
+ */
+template<typename T>
+const std::vector<size_t>& query_into_buffer(const GridIndex2D<T>& grid, T x1, T x2, T y1, T y2,
+                                             bool include_min, bool include_max) {
+    static thread_local std::vector<size_t> buffer;
+    grid.query_box_no_alloc(x1, x2, y1, y2, buffer, false, include_min, include_max);
+    return buffer;
+}
+
+/**
+ * @brief Number of indices a box query returns: the sizes of the cells it covers
+ */
+template<typename T>
+size_t count_box(const GridIndex2D<T>& grid, T x1, T x2, T y1, T y2,
+                 bool include_min, bool include_max) {
+    int i_min, i_max, j_min, j_max;
+    grid.get_box_cell_range(x1, x2, y1, y2, i_min, i_max, j_min, j_max, include_min, include_max);
+    size_t count = 0;
+    for (int j = j_min; j <= j_max; ++j) {
+        for (int i = i_min; i <= i_max; ++i) {
+            count += grid.get_cell(i, j).size();
+        }
+    }
+    return count;
+}
+
+template<typename T>
+PyObject* query_box_impl(GridIndexObject* self, double x1, double x2, double y1, double y2,
+                         bool include_min, bool include_max) {
+    const GridIndex2D<T>& grid = grid_of(self, T());
+    const T bx1 = static_cast<T>(x1), bx2 = static_cast<T>(x2);
+    const T by1 = static_cast<T>(y1), by2 = static_cast<T>(y2);
+    IndexArrayObject* result = new_index_array();
+    if (!result) return nullptr;
+
+    int i_min, i_max, j_min, j_max;
+    grid.get_box_cell_range(bx1, bx2, by1, by2, i_min, i_max, j_min, j_max,
+                            include_min, include_max);
+    const long cells = static_cast<long>(i_max - i_min + 1) * (j_max - j_min + 1);
+    if (cells > GIL_RELEASE_CELLS) {
+        std::shared_timed_mutex& lock = *self->lock;
+        if (!run_without_gil([&]() {
+                std::shared_lock<std::shared_timed_mutex> guard(lock);
+                const std::vector<size_t>& indices =
+                    query_into_buffer(grid, bx1, bx2, by1, by2, include_min, include_max);
+                std::copy(indices.begin(), indices.end(), allocate(result, indices.size()));
+            })) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+    } else {
+        lock_shared_with_gil(self);
+        try {
+            const std::vector<size_t>& indices =
+                query_into_buffer(grid, bx1, bx2, by1, by2, include_min, include_max);
+            std::copy(indices.begin(), indices.end(), allocate(result, indices.size()));
+        } catch (const std::bad_alloc&) {
+            self->lock->unlock_shared();
+            Py_DECREF(result);
+            return PyErr_NoMemory();
+        }
+        self->lock->unlock_shared();
+    }
+    return as_memoryview(result);
+}
+
+PyObject* GridIndex_query_box(GridIndexObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"x1", "x2", "y1", "y2", "include_min", "include_max",
+                                     nullptr};
+    double x1, x2, y1, y2;
+    int include_min = 1, include_max = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "dddd|pp", const_cast<char**>(keywords),
+                                     &x1, &x2, &y1, &y2, &include_min, &include_max)) {
+        return nullptr;
+    }
+    if (!check_initialized(self)) return nullptr;
+    return self->grid32
+        ? query_box_impl<float>(self, x1, x2, y1, y2, include_min != 0, include_max != 0)
+        : query_box_impl<double>(self, x1, x2, y1, y2, include_min != 0, include_max != 0);
+}
+
+template<typename T>
+PyObject* query_boxes_impl(GridIndexObject* self, PyObject* boxes_obj, bool include_min,
+                           bool include_max) {
+    BufferGuard boxes;
+    if (!get_buffer<T>(boxes_obj, boxes, "boxes")) return nullptr;
+    const size_t values = static_cast<size_t>(boxes.view.len) / sizeof(T);
+    if (values % 4 != 0 || (boxes.view.ndim > 1 && boxes.view.shape[boxes.view.ndim - 1] != 4)) {
+        PyErr_SetString(PyExc_ValueError, "boxes must have shape (n, 4): x1, x2, y1, y2");
+        return nullptr;
+    }
+    const size_t n_boxes = values / 4;
+    const T* box = static_cast<const T*>(boxes.view.buf);
+
+    IndexArrayObject* offsets = new_index_array();
+    IndexArrayObject* indices = offsets ? new_index_array() : nullptr;
+    if (!indices) {
+        Py_XDECREF(offsets);
+        return nullptr;
+    }
+    const GridIndex2D<T>& grid = grid_of(self, T());
+    std::shared_timed_mutex& lock = *self->lock;
+    if (!run_without_gil([&]() {
+            std::shared_lock<std::shared_timed_mutex> guard(lock);
+            // Offsets first, from the cell sizes, so the indices are written
+            // into one allocation of the final size. Growing the output by
+            // appending costs several times the queries themselves on large
+            // batches (reallocation copies and fresh page faults).
+            int64_t* off = allocate(offsets, n_boxes + 1);
+            off[0] = 0;
+            for (size_t b = 0; b < n_boxes; ++b) {
+                const T* q = box + 4 * b;
+                off[b + 1] = off[b] + static_cast<int64_t>(
+                    count_box(grid, q[0], q[1], q[2], q[3], include_min, include_max));
+            }
+            int64_t* out = allocate(indices, static_cast<size_t>(off[n_boxes]));
+            for (size_t b = 0; b < n_boxes; ++b) {
+                const T* q = box + 4 * b;
+                const std::vector<size_t>& found =
+                    query_into_buffer(grid, q[0], q[1], q[2], q[3], include_min, include_max);
+                std::copy(found.begin(), found.end(), out + off[b]);
+            }
+        })) {
+        Py_DECREF(offsets);
+        Py_DECREF(indices);
+        return nullptr;
+    }
+    PyObject* off_view = as_memoryview(offsets);
+    PyObject* idx_view = as_memoryview(indices);
+    if (!off_view || !idx_view) {
+        Py_XDECREF(off_view);
+        Py_XDECREF(idx_view);
+        return nullptr;
+    }
+    PyObject* result = PyTuple_Pack(2, off_view, idx_view);
+    Py_DECREF(off_view);
+    Py_DECREF(idx_view);
+    return result;
+}
+
+PyObject* GridIndex_query_boxes(GridIndexObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"boxes", "include_min", "include_max", nullptr};
+    PyObject* boxes;
+    int include_min = 1, include_max = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|pp", const_cast<char**>(keywords),
+                                     &boxes, &include_min, &include_max)) {
+        return nullptr;
+    }
+    if (!check_initialized(self)) return nullptr;
+    return self->grid32
+        ? query_boxes_impl<float>(self, boxes, include_min != 0, include_max != 0)
+        : query_boxes_impl<double>(self, boxes, include_min != 0, include_max != 0);
+}
+
+PyObject* GridIndex_clear(GridIndexObject* self, PyObject*) {
+    if (!check_initialized(self)) return nullptr;
+    std::shared_timed_mutex& lock = *self->lock;
+    if (!run_without_gil([&]() {
+            std::unique_lock<std::shared_timed_mutex> guard(lock);
+            if (self->grid32) {
+                self->grid32->clear();
+            } else {
+                self->grid64->clear();
+            }
+        })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+Py_ssize_t GridIndex_len(GridIndexObject* self) {
+    if (!check_initialized(self)) return -1;
+    lock_shared_with_gil(self);
+    const size_t n = self->grid32 ? self->grid32->get_num_points() : self->grid64->get_num_points();
+    self->lock->unlock_shared();
+    return static_cast<Py_ssize_t>(n);
+}
+
+PyObject* GridIndex_get_num_points(GridIndexObject* self, void*) {
+    const Py_ssize_t n = GridIndex_len(self);
+    return n < 0 ? nullptr : PyLong_FromSsize_t(n);
+}
+
+PyObject* GridIndex_get_dtype(GridIndexObject* self, void*) {
+    if (!check_initialized(self)) return nullptr;
+    return PyUnicode_FromString(self->grid32 ? "float32" : "float64");
+}
+
+PyMethodDef grid_index_methods[] = {
+    {"insert_points", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(GridIndex_insert_points)),
+     METH_VARARGS | METH_KEYWORDS,
+     "insert_points(xs, ys, first_index=0)\n--\n\n"
+     "Insert points from two 1-d coordinate buffers of the grid's dtype, read\n"
+     "in place. Point k gets index first_index + k. Runs without the GIL."},
+    {"query_box", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(GridIndex_query_box)),
+     METH_VARARGS | METH_KEYWORDS,
+     "query_box(x1, x2, y1, y2, include_min=True, include_max=True)\n--\n\n"
+     "Indices of the points in the box, as an int64 memoryview."},
+    {"query_boxes", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(GridIndex_query_boxes)),
+     METH_VARARGS | METH_KEYWORDS,
+     "query_boxes(boxes, include_min=True, include_max=True)\n--\n\n"
+     "Batch query. boxes is an (n, 4) buffer of the grid's dtype holding\n"
+     "x1, x2, y1, y2 per row. Returns (offsets, indices) in CSR form as int64\n"
+     "memoryviews: the indices of box b are indices[offsets[b]:offsets[b + 1]].\n"
+     "Runs without the GIL."},
+    {"clear", reinterpret_cast<PyCFunction>(GridIndex_clear), METH_NOARGS,
+     "clear()\n--\n\nRemove all points, keeping the cell structure."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyGetSetDef grid_index_getset[] = {
+    {const_cast<char*>("num_points"), reinterpret_cast<getter>(GridIndex_get_num_points), nullptr,
+     const_cast<char*>("Number of stored point indices"), nullptr},
+    {const_cast<char*>("dtype"), reinterpret_cast<getter>(GridIndex_get_dtype), nullptr,
+     const_cast<char*>("Coordinate type: 'float32' or 'float64'"), nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+PyType_Slot grid_index_slots[] = {
+    {Py_tp_doc, const_cast<char*>(
+        "GridIndex(x_start, x_end, x_step, y_start, y_end, y_step, dtype='float64')\n--\n\n"
+        "Uniform grid spatial index over float32 or float64 coordinates.")},
+    {Py_tp_new, reinterpret_cast<void*>(PyType_GenericNew)},
+    {Py_tp_init, reinterpret_cast<void*>(GridIndex_init)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(GridIndex_dealloc)},
+    {Py_tp_methods, grid_index_methods},
+    {Py_tp_getset, grid_index_getset},
+    {Py_sq_length, reinterpret_cast<void*>(GridIndex_len)},
+    {0, nullptr}
+};
+
+PyType_Spec grid_index_spec = {
+    "grid_index.GridIndex", sizeof(GridIndexObject), 0,
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, grid_index_slots
+};
+
+PyModuleDef grid_index_module = {
+    PyModuleDef_HEAD_INIT, "grid_index",
+    "Uniform grid spatial index (GridIndex2D) with buffer-protocol input and CSR batch queries",
+    -1, nullptr, nullptr, nullptr, nullptr, nullptr
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_grid_index(void) {
+    index_array_type = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&index_array_spec));
+    if (!index_array_type) return nullptr;
+    grid_index_type = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&grid_index_spec));
+    if (!grid_index_type) return nullptr;
+
+    PyObject* module = PyModule_Create(&grid_index_module);
+    if (!module) return nullptr;
+    Py_INCREF(grid_index_type);
+    if (PyModule_AddObject(module, "GridIndex", reinterpret_cast<PyObject*>(grid_index_type)) < 0) {
+        Py_DECREF(grid_index_type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
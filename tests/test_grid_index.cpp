@@ -10,7 +10,10 @@
 #include <cassert>
 #include <cmath>
 #include <algorithm>
+#include <limits>
+#include <thread>
 #include "../include/grid_index.h"
+#include "../include/seismic_datasets.h"
 
 #define TEST(name) void name()
 #define ASSERT_EQ(a, b) assert((a) == (b))
@@ -639,6 +642,1115 @@ TEST(test_edge_handling_default_params) {
     ASSERT_TRUE(result1 == result2);
 }
 
+// Check a synthetic acquisition dataset: deterministic, chunk-streamable,
+// and the grid returns every point that lies inside a query box
+template<typename Generator>
+void check_seismic_dataset(const Generator& generator) {
+    std::vector<float> xs, ys, xs2, ys2;
+    generator.materialize(xs, ys);
+    generator.materialize(xs2, ys2);
+    ASSERT_TRUE(xs == xs2 && ys == ys2);
+
+    // Streaming in odd-sized chunks yields the same points
+    size_t streamed = 0;
+    bool same = true;
+    generator.for_each_chunk(777, [&](const float* cx, const float* cy,
+                                      size_t n, uint64_t first) {
+        for (size_t k = 0; k < n; ++k) {
+            same = same && cx[k] == xs[first + k] && cy[k] == ys[first + k];
+        }
+        streamed += n;
+    });
+    ASSERT_TRUE(same);
+    ASSERT_EQ(streamed, xs.size());
+    ASSERT_THROW(generator.for_each_chunk(0, [](const float*, const float*, size_t, uint64_t) {}),
+                 std::invalid_argument);
+
+    seismic::Bounds b = generator.bounds();
+    GridIndex2D<float> grid(static_cast<float>(b.x_min), static_cast<float>(b.x_max), 100.0f,
+                            static_cast<float>(b.y_min), static_cast<float>(b.y_max), 100.0f);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        ASSERT_TRUE(xs[i] >= b.x_min && xs[i] <= b.x_max);
+        ASSERT_TRUE(ys[i] >= b.y_min && ys[i] <= b.y_max);
+        grid.insert(xs[i], ys[i], i);
+    }
+
+    for (size_t q = 0; q < 20; ++q) {
+        size_t c = (q * 7919) % xs.size();
+        float x1 = xs[c] - 150.0f, x2 = xs[c] + 150.0f;
+        float y1 = ys[c] - 150.0f, y2 = ys[c] + 150.0f;
+        std::vector<size_t> result = grid.query_box(x1, x2, y1, y2);
+        std::sort(result.begin(), result.end());
+        for (size_t i = 0; i < xs.size(); ++i) {
+            if (xs[i] >= x1 && xs[i] <= x2 && ys[i] >= y1 && ys[i] <= y2) {
+                ASSERT_TRUE(std::binary_search(result.begin(), result.end(), i));
+            }
+        }
+    }
+}
+
+// Test grid queries on realistic acquisition geometries
+TEST(test_seismic_datasets) {
+    check_seismic_dataset(seismic::LandOrthogonalGenerator<float>(20000, 1));
+    check_seismic_dataset(seismic::MarineStreamerGenerator<float>(20000, 2));
+    check_seismic_dataset(seismic::ObnPatchGenerator<float>(20000, 3));
+    check_seismic_dataset(seismic::Crooked2DGenerator<float>(20000, 4));
+}
+
+// Test query instrumentation counters (zero unless compiled with
+// GRID_INDEX_ENABLE_QUERY_STATS, see the test_grid_index_stats target)
+TEST(test_query_stats) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f,
+                            0.0f, 100.0f, 10.0f);
+    grid.insert(15.0f, 15.0f, 0);   // Cell (1, 1)
+    grid.insert(16.0f, 16.0f, 1);   // Cell (1, 1)
+    grid.insert(25.0f, 35.0f, 2);   // Cell (2, 3)
+
+    GridIndex2D<float>::reset_query_stats();
+
+    // Cells x 1..3, y 1..3: 9 cells, 2 of them non-empty, 3 candidates
+    std::vector<size_t> result = grid.query_box(10.0f, 39.0f, 10.0f, 39.0f);
+    grid.query_box_no_alloc(10.0f, 39.0f, 10.0f, 39.0f, result);
+    size_t calls = 0;
+    grid.query_box_callback(10.0f, 39.0f, 10.0f, 39.0f, [&](size_t) { ++calls; });
+    ASSERT_EQ(calls, 3);
+    for (size_t idx : grid.query_box_range(10.0f, 39.0f, 10.0f, 39.0f)) {
+        (void)idx;
+        ++calls;
+    }
+    ASSERT_EQ(calls, 6);
+
+    GridQueryStats stats = GridIndex2D<float>::query_stats();
+#ifdef GRID_INDEX_ENABLE_QUERY_STATS
+    ASSERT_EQ(stats.queries, 4);
+    ASSERT_EQ(stats.cells_visited, 36);
+    ASSERT_EQ(stats.empty_cells_skipped, 28);
+    ASSERT_EQ(stats.candidates, 12);
+    // Ranges do not count emitted indices
+    ASSERT_EQ(stats.emitted, 9);
+
+    // Counters are shared across coordinate types and reset per thread
+    GridIndex2D<double> grid_d(0.0, 10.0, 1.0, 0.0, 10.0, 1.0);
+    grid_d.query_box(0.0, 0.5, 0.0, 0.5);
+    ASSERT_EQ(GridIndex2D<float>::query_stats().queries, 5);
+    GridIndex2D<double>::reset_query_stats();
+    ASSERT_EQ(GridIndex2D<float>::query_stats().queries, 0);
+
+    // A range stopped early: one query, cells up to the stopping point
+    GridIndex2D<float>::reset_query_stats();
+    for (size_t idx : grid.query_box_range(10.0f, 39.0f, 10.0f, 39.0f)) {
+        if (idx == 0) break;
+    }
+    stats = GridIndex2D<float>::query_stats();
+    ASSERT_EQ(stats.queries, 1);
+    ASSERT_EQ(stats.cells_visited, 1);
+    ASSERT_EQ(stats.candidates, 2);
+    ASSERT_EQ(stats.emitted, 0);
+#else
+    ASSERT_EQ(stats.queries, 0);
+    ASSERT_EQ(stats.cells_visited, 0);
+    ASSERT_EQ(stats.candidates, 0);
+#endif
+}
+
+// Test latency histogram bucketing and percentiles
+TEST(test_latency_histogram) {
+    // Bucket bounds are contiguous and contain their values
+    for (int b = 1; b < LatencyHistogram::NUM_BUCKETS; ++b) {
+        ASSERT_EQ(LatencyHistogram::bucket_lower(b), LatencyHistogram::bucket_upper(b - 1) + 1);
+        ASSERT_EQ(LatencyHistogram::bucket_index(LatencyHistogram::bucket_lower(b)), b);
+        ASSERT_EQ(LatencyHistogram::bucket_index(LatencyHistogram::bucket_upper(b)), b);
+    }
+
+    LatencyHistogram h;
+    ASSERT_EQ(h.percentile(0.5), 0);
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        h.record(v * 100);  // 100 ns .. 100 us
+    }
+    LatencySummary s = h.summary();
+    ASSERT_EQ(s.count, 1000);
+    ASSERT_TRUE(std::fabs(s.mean_ns - 50050.0) < 1e-9);
+    ASSERT_EQ(s.min_ns, 100);
+    // Percentiles are within the 1/32 bucket resolution
+    ASSERT_TRUE(s.p50_ns >= 50000 && s.p50_ns <= 50000 + 50000 / 32);
+    ASSERT_TRUE(s.p99_ns >= 99000 && s.p99_ns <= 99000 + 99000 / 32);
+    ASSERT_TRUE(s.max_ns >= 100000 && s.max_ns <= 100000 + 100000 / 32);
+
+    LatencyHistogram other;
+    other.record(7);
+    h.merge(other);
+    ASSERT_EQ(h.count(), 1001);
+    ASSERT_EQ(h.summary().min_ns, 7);
+    h.subtract(other);
+    ASSERT_EQ(h.count(), 1000);
+}
+
+// Test per-API latency recording across threads (enabled in the
+// test_grid_index_stats target)
+TEST(test_query_latency) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f,
+                            0.0f, 100.0f, 10.0f);
+    grid.insert(15.0f, 15.0f, 0);
+
+    GridIndex2D<float>::reset_query_latency();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([&grid]() {
+            std::vector<size_t> result;
+            for (int q = 0; q < 100; ++q) {
+                grid.query_box_no_alloc(10.0f, 20.0f, 10.0f, 20.0f, result);
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    grid.query_box(10.0f, 20.0f, 10.0f, 20.0f);
+
+    LatencyHistogram no_alloc = GridIndex2D<float>::query_latency(GRID_QUERY_BOX_NO_ALLOC);
+    LatencyHistogram box = GridIndex2D<float>::query_latency(GRID_QUERY_BOX);
+    LatencyHistogram callback = GridIndex2D<float>::query_latency(GRID_QUERY_BOX_CALLBACK);
+#ifdef GRID_INDEX_ENABLE_LATENCY_HISTOGRAMS
+    ASSERT_EQ(no_alloc.count(), 400);
+    ASSERT_EQ(box.count(), 1);
+    ASSERT_EQ(callback.count(), 0);
+    LatencySummary s = no_alloc.summary();
+    ASSERT_TRUE(s.min_ns <= s.p50_ns && s.p50_ns <= s.p99_ns && s.p99_ns <= s.max_ns);
+
+    // Samples recorded by exited threads survive; reset starts from zero
+    GridIndex2D<float>::reset_query_latency();
+    ASSERT_EQ(GridIndex2D<float>::query_latency(GRID_QUERY_BOX_NO_ALLOC).count(), 0);
+    grid.query_box_callback(10.0f, 20.0f, 10.0f, 20.0f, [](size_t) {});
+    ASSERT_EQ(GridIndex2D<float>::query_latency(GRID_QUERY_BOX_CALLBACK).count(), 1);
+    grid.exists_in_box(10.0f, 20.0f, 10.0f, 20.0f);
+    ASSERT_EQ(GridIndex2D<float>::query_latency(GRID_QUERY_EXISTS).count(), 1);
+#else
+    ASSERT_EQ(no_alloc.count() + box.count() + callback.count(), 0);
+#endif
+}
+
+// Test memory accounting
+TEST(test_memory_usage) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f,
+                            0.0f, 100.0f, 10.0f);
+
+    GridMemoryUsage empty = grid.memory_usage();
+    ASSERT_EQ(empty.cell_headers_used, 100 * sizeof(std::vector<size_t>));
+    ASSERT_EQ(empty.indices_used, 0);
+    ASSERT_EQ(empty.indices_reserved, 0);
+
+    for (size_t k = 0; k < 5; ++k) {
+        grid.insert(15.0f, 15.0f, k);
+    }
+    GridMemoryUsage usage = grid.memory_usage();
+    ASSERT_EQ(usage.indices_used, 5 * sizeof(size_t));
+    ASSERT_TRUE(usage.indices_reserved >= usage.indices_used);
+    ASSERT_TRUE(usage.total_reserved() >= usage.total_used());
+    ASSERT_EQ(usage.total_used(),
+              usage.object_bytes + usage.cell_headers_used + usage.indices_used);
+
+    // clear() keeps capacity: used drops, reserved does not
+    grid.clear();
+    ASSERT_EQ(grid.get_num_points(), 0);
+    ASSERT_EQ(grid.memory_usage().indices_used, 0);
+    ASSERT_EQ(grid.memory_usage().indices_reserved, usage.indices_reserved);
+}
+
+// Test occupancy diagnostics
+TEST(test_occupancy) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f,
+                            0.0f, 100.0f, 10.0f);
+
+    // One cell with 9 points, ten cells with 1 point, 89 empty cells
+    for (size_t k = 0; k < 9; ++k) {
+        grid.insert(55.0f, 55.0f, k);
+    }
+    for (int i = 0; i < 10; ++i) {
+        grid.insert(i * 10.0f + 5.0f, 5.0f, 100 + i);
+    }
+
+    GridOccupancy occ = grid.occupancy();
+    ASSERT_EQ(occ.num_cells, 100);
+    ASSERT_EQ(occ.num_points, 19);
+    ASSERT_EQ(occ.empty_cells, 89);
+    ASSERT_EQ(occ.max_cell_size, 9);
+    ASSERT_TRUE(std::fabs(occ.mean_cell_size - 0.19) < 1e-12);
+    ASSERT_EQ(occ.p50_cell_size, 0);
+    ASSERT_EQ(occ.p90_cell_size, 1);
+    ASSERT_EQ(occ.p99_cell_size, 1);
+    ASSERT_EQ(occ.size_histogram.size(), 5);  // 9 points -> bucket [8, 16)
+    ASSERT_EQ(occ.size_histogram[0], 89);
+    ASSERT_EQ(occ.size_histogram[1], 10);
+    ASSERT_EQ(occ.size_histogram[4], 1);
+}
+
+// Test trimming capacity after an insert-based build
+TEST(test_shrink_to_fit) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f,
+                            0.0f, 100.0f, 10.0f);
+    for (size_t k = 0; k < 33; ++k) {
+        grid.insert(15.0f, 15.0f, k);
+    }
+    grid.insert(75.0f, 75.0f, 33);
+
+    grid.shrink_to_fit();
+    GridMemoryUsage usage = grid.memory_usage();
+    ASSERT_EQ(usage.indices_reserved, usage.indices_used);
+    ASSERT_EQ(grid.get_num_points(), 34);
+
+    auto result = grid.query_box(10.0f, 19.0f, 10.0f, 19.0f);
+    ASSERT_EQ(result.size(), 33);
+    ASSERT_EQ(result[0], 0);
+    ASSERT_EQ(result[32], 32);
+}
+
+// Test reserving per-cell capacities from a known histogram
+TEST(test_reserve_cells) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f,
+                            0.0f, 100.0f, 10.0f);
+
+    std::vector<size_t> counts(100, 0);
+    counts[1 * 10 + 1] = 50;  // Cell (1, 1)
+    counts[5 * 10 + 7] = 3;   // Cell (7, 5)
+    grid.reserve_cells(counts);
+    ASSERT_EQ(grid.memory_usage().indices_reserved, 53 * sizeof(size_t));
+
+    for (size_t k = 0; k < 50; ++k) {
+        grid.insert(15.0f, 15.0f, k);
+    }
+    for (size_t k = 0; k < 3; ++k) {
+        grid.insert(75.0f, 55.0f, 50 + k);
+    }
+    // Exactly as reserved: no growth slack
+    GridMemoryUsage usage = grid.memory_usage();
+    ASSERT_EQ(usage.indices_reserved, usage.indices_used);
+
+    ASSERT_THROW(grid.reserve_cells(std::vector<size_t>(99, 1)), std::invalid_argument);
+}
+
+// Test releasing memory on clear
+TEST(test_clear_release_memory) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f,
+                            0.0f, 100.0f, 10.0f);
+    for (size_t k = 0; k < 100; ++k) {
+        grid.insert(k * 1.0f, k * 1.0f, k);
+    }
+
+    grid.clear();
+    ASSERT_TRUE(grid.memory_usage().indices_reserved > 0);
+
+    grid.insert(15.0f, 15.0f, 0);
+    grid.clear(true);
+    ASSERT_EQ(grid.get_num_points(), 0);
+    ASSERT_EQ(grid.memory_usage().indices_reserved, 0);
+
+    // Still usable after releasing
+    grid.insert(15.0f, 15.0f, 7);
+    auto result = grid.query_box(10.0f, 20.0f, 10.0f, 20.0f);
+    ASSERT_EQ(result.size(), 1);
+    ASSERT_EQ(result[0], 7);
+}
+
+// Test presized construction from a cell-count array
+TEST(test_presized_construction) {
+    GridIndex2D<float> first(0.0f, 100.0f, 10.0f,
+                             0.0f, 100.0f, 10.0f);
+    std::vector<float> xs, ys;
+    for (int k = 0; k < 500; ++k) {
+        xs.push_back(static_cast<float>((k * 37) % 100));
+        ys.push_back(static_cast<float>((k * 53) % 100));
+        first.insert(xs.back(), ys.back(), k);
+    }
+    std::vector<size_t> fold = first.get_cell_counts();
+    ASSERT_EQ(fold.size(), first.get_num_cells());
+    ASSERT_TRUE(fold == first.count_cells(xs.data(), ys.data(), xs.size()));
+
+    GridIndex2D<float> second(0.0f, 100.0f, 10.0f,
+                              0.0f, 100.0f, 10.0f, fold);
+    ASSERT_EQ(second.memory_usage().indices_reserved, 500 * sizeof(size_t));
+    for (size_t k = 0; k < xs.size(); ++k) {
+        second.insert(xs[k], ys[k], k);
+    }
+    GridMemoryUsage usage = second.memory_usage();
+    ASSERT_EQ(usage.indices_reserved, usage.indices_used);
+    ASSERT_TRUE(second.query_box(0.0f, 100.0f, 0.0f, 100.0f) ==
+                first.query_box(0.0f, 100.0f, 0.0f, 100.0f));
+
+    ASSERT_THROW(GridIndex2D<float>(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f,
+                                    std::vector<size_t>(3, 0)),
+                 std::invalid_argument);
+}
+
+// Test bulk insertion matches point-by-point insertion
+TEST(test_insert_points) {
+    std::vector<double> xs, ys;
+    for (int k = 0; k < 1000; ++k) {
+        xs.push_back(-5.0 + (k * 7919) % 1110 / 10.0);  // Includes out-of-bounds points
+        ys.push_back(-5.0 + (k * 104729) % 1110 / 10.0);
+    }
+
+    GridIndex2D<double> incremental(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    incremental.insert(50.0, 50.0, 9999);
+    for (size_t k = 0; k < xs.size(); ++k) {
+        incremental.insert(xs[k], ys[k], 100 + k);
+    }
+
+    GridIndex2D<double> bulk(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    bulk.insert(50.0, 50.0, 9999);
+    bulk.insert_points(xs.data(), ys.data(), xs.size(), 100);
+
+    ASSERT_EQ(bulk.get_num_points(), 1001);
+    ASSERT_TRUE(bulk.get_cell_counts() == incremental.get_cell_counts());
+    ASSERT_TRUE(bulk.query_box(0.0, 100.0, 0.0, 100.0) ==
+                incremental.query_box(0.0, 100.0, 0.0, 100.0));
+    ASSERT_TRUE(bulk.query_box(23.0, 48.0, 61.0, 77.0) ==
+                incremental.query_box(23.0, 48.0, 61.0, 77.0));
+
+    // Empty input is a no-op
+    bulk.insert_points(xs.data(), ys.data(), 0);
+    ASSERT_EQ(bulk.get_num_points(), 1001);
+}
+
+// Test cell mapping for steps that are not exactly representable
+TEST(test_cell_mapping_edges) {
+    const double step = 0.1;
+    GridIndex2D<double> grid(0.0, 1.0, step, 0.0, 1.0, step);
+    ASSERT_EQ(grid.get_num_cells(), 100);
+
+    // A point on the edge k * step belongs to cell k, just below it to cell k - 1
+    for (int k = 0; k < 10; ++k) {
+        const double edge = k * step;
+        grid.insert(edge, 0.05, k);
+        if (k > 0) {
+            grid.insert(std::nextafter(edge, 0.0), 0.15, 100 + k);
+        }
+    }
+    std::vector<size_t> counts = grid.get_cell_counts();
+    for (int k = 0; k < 10; ++k) {
+        ASSERT_EQ(counts[k], 1);
+        ASSERT_EQ(counts[10 + k], k < 9 ? 1 : 0);
+    }
+
+    // An open box edge exactly on a cell edge skips the cell beyond it ...
+    const double edge = 3 * step;  // 0.30000000000000004, not 0.3
+    ASSERT_EQ(grid.query_box(edge, 0.55, -0.05, 0.09).size(), 3);
+    std::vector<size_t> result = grid.query_box(edge, 0.55, -0.05, 0.09, false, true);
+    std::sort(result.begin(), result.end());
+    ASSERT_EQ(result.size(), 2);
+    ASSERT_EQ(result[0], 4);
+    ASSERT_EQ(grid.query_box(0.3, 0.55, -0.05, 0.09, false, true).size(), 4);
+
+    // ... but one just inside the cell does not, however small the offset
+    const double tiny = std::numeric_limits<double>::denorm_min();
+    result = grid.query_box(tiny, 0.05, -0.05, 0.09, false, false);
+    ASSERT_EQ(result.size(), 1);
+    ASSERT_EQ(result[0], 0);
+}
+
+// Test batched cell ids match point-by-point mapping
+template<typename T>
+void check_compute_cell_ids() {
+    GridIndex2D<T> grid(T(-3.7), T(96.3), T(0.1), T(0), T(50), T(0.25));
+    std::vector<T> xs, ys;
+    for (int k = 0; k < 1003; ++k) {  // Not a multiple of any vector width
+        xs.push_back(T(-10) + T((k * 7919) % 1200) / T(10));
+        ys.push_back(T(-5) + T((k * 104729) % 240) / T(4));
+    }
+    xs[5] = std::numeric_limits<T>::quiet_NaN();
+    ys[6] = std::numeric_limits<T>::infinity();
+    xs[7] = -std::numeric_limits<T>::max();
+    xs[8] = T(-3.7) + T(12) * T(0.1);  // On a cell edge
+    xs[9] = std::nextafter(xs[8], T(-1e30));
+
+    std::vector<int> ids(xs.size());
+    grid.compute_cell_ids(xs.data(), ys.data(), xs.size(), ids.data());
+    for (size_t k = 0; k < xs.size(); ++k) {
+        int expected;
+        grid.compute_cell_ids(&xs[k], &ys[k], 1, &expected);  // Scalar path
+        ASSERT_EQ(ids[k], expected);
+        ASSERT_TRUE(ids[k] >= 0 && static_cast<size_t>(ids[k]) < grid.get_num_cells());
+    }
+
+    GridIndex2D<T> incremental(T(-3.7), T(96.3), T(0.1), T(0), T(50), T(0.25));
+    for (size_t k = 0; k < xs.size(); ++k) {
+        incremental.insert(xs[k], ys[k], k);
+    }
+    ASSERT_TRUE(grid.count_cells(xs.data(), ys.data(), xs.size()) ==
+                incremental.get_cell_counts());
+}
+
+TEST(test_compute_cell_ids) {
+    check_compute_cell_ids<float>();
+    check_compute_cell_ids<double>();
+}
+
+// Test compile-time edge modes match the runtime edge flags
+TEST(test_compile_time_edges) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f);
+    for (int k = 0; k < 400; ++k) {
+        grid.insert(static_cast<float>((k * 37) % 101), static_cast<float>((k * 53) % 101), k);
+    }
+    ASSERT_TRUE(grid_edges(true, true) == Edges::Inclusive);
+    ASSERT_TRUE(grid_edges(false, false) == Edges::Exclusive);
+    ASSERT_TRUE(grid_edges(true, false) == Edges::HalfOpen);
+    ASSERT_TRUE(grid_edges(false, true) == Edges::ReverseHalfOpen);
+
+    const float boxes[][4] = {{10, 30, 20, 40}, {15, 25, 15, 25}, {0, 100, 0, 100}, {30, 10, 40, 20}};
+    for (const auto& b : boxes) {
+        ASSERT_TRUE(grid.query_box<Edges::Inclusive>(b[0], b[1], b[2], b[3]) ==
+                    grid.query_box(b[0], b[1], b[2], b[3], true, true));
+        ASSERT_TRUE(grid.query_box<Edges::Exclusive>(b[0], b[1], b[2], b[3]) ==
+                    grid.query_box(b[0], b[1], b[2], b[3], false, false));
+        ASSERT_TRUE(grid.query_box<Edges::HalfOpen>(b[0], b[1], b[2], b[3]) ==
+                    grid.query_box(b[0], b[1], b[2], b[3], true, false));
+        ASSERT_TRUE(grid.query_box<Edges::ReverseHalfOpen>(b[0], b[1], b[2], b[3]) ==
+                    grid.query_box(b[0], b[1], b[2], b[3], false, true));
+
+        std::vector<size_t> expected = grid.query_box(b[0], b[1], b[2], b[3], true, false);
+        std::vector<size_t> result(1, 9999);
+        grid.query_box_no_alloc<Edges::HalfOpen>(b[0], b[1], b[2], b[3], result);
+        ASSERT_TRUE(result == expected);
+        grid.query_box_no_alloc<Edges::HalfOpen>(b[0], b[1], b[2], b[3], result, true);
+        ASSERT_EQ(result.size(), 2 * expected.size());
+
+        std::vector<size_t> visited;
+        grid.query_box_callback<Edges::HalfOpen>(b[0], b[1], b[2], b[3],
+                                                 [&](size_t idx) { visited.push_back(idx); });
+        ASSERT_TRUE(visited == expected);
+    }
+}
+
+// Test integral coordinates (bin numbers) use exact integer cell mapping
+TEST(test_integer_coordinates) {
+    // Non-power-of-two step: extent 1102 needs 368 cells of 3
+    GridIndex2D<int> grid(-101, 1001, 3, 0, 10, 1);
+    int nx, ny;
+    grid.get_dimensions(nx, ny);
+    ASSERT_EQ(nx, 368);
+    ASSERT_EQ(ny, 10);
+
+    grid.insert(-101, 0, 0);  // First cell
+    grid.insert(-99, 0, 1);   // Last value of the first cell
+    grid.insert(-98, 0, 2);   // Edge of the second cell
+    grid.insert(-500, 0, 3);  // Clamped into the first cell
+    std::vector<size_t> result = grid.query_box(-101, -99, 0, 0);
+    std::sort(result.begin(), result.end());
+    ASSERT_EQ(result.size(), 3);
+    ASSERT_EQ(result[2], 3);
+    ASSERT_EQ(grid.query_box(-98, -98, 0, 0).size(), 1);
+
+    // Open box edges on cell edges are detected exactly
+    ASSERT_EQ(grid.query_box<Edges::HalfOpen>(-101, -98, 0, 1).size(), 3);
+    ASSERT_EQ(grid.query_box<Edges::Exclusive>(-104, -98, -1, 1).size(), 3);
+
+    // Power-of-two step maps by shifting, including negative offsets
+    GridIndex2D<int> bins(-64, 64, 16, -64, 64, 16);
+    std::vector<int> xs, ys;
+    for (int v = -80; v <= 80; ++v) {
+        xs.push_back(v);
+        ys.push_back(-v);
+    }
+    std::vector<int> ids(xs.size());
+    bins.compute_cell_ids(xs.data(), ys.data(), xs.size(), ids.data());
+    for (size_t k = 0; k < xs.size(); ++k) {
+        int i = static_cast<int>(std::floor((xs[k] + 64) / 16.0));
+        int j = static_cast<int>(std::floor((ys[k] + 64) / 16.0));
+        i = std::max(0, std::min(i, 7));
+        j = std::max(0, std::min(j, 7));
+        ASSERT_EQ(ids[k], j * 8 + i);
+    }
+
+    GridIndex2D<unsigned> lines(1000, 1100, 1, 2000, 2100, 1);
+    lines.insert(1042u, 2017u, 7);
+    result = lines.query_box(1042u, 1042u, 2017u, 2017u);
+    ASSERT_EQ(result.size(), 1);
+    ASSERT_EQ(result[0], 7);
+    ASSERT_TRUE(lines.query_box(1043u, 1050u, 2017u, 2017u).empty());
+}
+
+// Test lazy range queries yield the same indices as query_box()
+TEST(test_query_box_range) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f);
+    for (int k = 0; k < 300; ++k) {
+        grid.insert(static_cast<float>((k * 37) % 101), static_cast<float>((k * 53) % 71), k);
+    }
+
+    const float boxes[][4] = {{10, 30, 20, 40}, {0, 100, 0, 100}, {95, 99, 95, 99}, {30, 10, 40, 20}};
+    for (const auto& b : boxes) {
+        std::vector<size_t> visited;
+        for (size_t idx : grid.query_box_range(b[0], b[1], b[2], b[3])) {
+            visited.push_back(idx);
+        }
+        ASSERT_TRUE(visited == grid.query_box(b[0], b[1], b[2], b[3]));
+
+        GridIndex2D<float>::BoxQueryRange r = grid.query_box_range<Edges::HalfOpen>(b[0], b[1], b[2], b[3]);
+        ASSERT_TRUE(std::vector<size_t>(r.begin(), r.end()) ==
+                    grid.query_box(b[0], b[1], b[2], b[3], true, false));
+        ASSERT_EQ(static_cast<size_t>(std::distance(r.begin(), r.end())),
+                  grid.query_box(b[0], b[1], b[2], b[3], true, false).size());
+    }
+
+    // Early termination
+    size_t seen = 0;
+    for (size_t idx : grid.query_box_range(0.0f, 100.0f, 0.0f, 100.0f)) {
+        (void)idx;
+        if (++seen == 5) break;
+    }
+    ASSERT_EQ(seen, 5);
+    GridIndex2D<float>::BoxQueryRange all = grid.query_box_range(0.0f, 100.0f, 0.0f, 100.0f);
+    ASSERT_TRUE(std::find(all.begin(), all.end(), size_t(299)) != all.end());
+
+    // Empty ranges: no points in the box, or an exclusive box between two cell edges
+    ASSERT_TRUE(grid.query_box_range(0.0f, 5.0f, 80.0f, 90.0f).empty());
+    ASSERT_TRUE(grid.query_box_range(10.0f, 20.0f, 10.0f, 20.0f, false, false).empty());
+    GridIndex2D<double> none(0.0, 10.0, 1.0, 0.0, 10.0, 1.0);
+    ASSERT_TRUE(none.query_box_range(0.0, 10.0, 0.0, 10.0).begin() ==
+                none.query_box_range(0.0, 10.0, 0.0, 10.0).end());
+}
+
+// Test early-terminating callbacks, existence checks and limit/offset queries
+TEST(test_early_termination) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f);
+    for (int k = 0; k < 500; ++k) {
+        grid.insert(static_cast<float>((k * 37) % 100), static_cast<float>((k * 53) % 60), k);
+    }
+    const std::vector<size_t> all = grid.query_box(5.0f, 95.0f, 5.0f, 95.0f);
+
+    // A callback returning Visit::Stop ends the query
+    std::vector<size_t> visited;
+    grid.query_box_callback(5.0f, 95.0f, 5.0f, 95.0f, [&](size_t idx) {
+        visited.push_back(idx);
+        return visited.size() == 7 ? Visit::Stop : Visit::Continue;
+    });
+    ASSERT_EQ(visited.size(), 7);
+    ASSERT_TRUE(std::equal(visited.begin(), visited.end(), all.begin()));
+
+    // Existence checks, in both cell orders
+    ASSERT_TRUE(grid.exists_in_box(5.0f, 95.0f, 5.0f, 95.0f));
+    ASSERT_TRUE(grid.exists_in_box(5.0f, 95.0f, 5.0f, 95.0f, CellOrder::CenterOut));
+    ASSERT_TRUE(!grid.exists_in_box(0.0f, 100.0f, 70.0f, 100.0f));  // y >= 60 is empty
+    ASSERT_TRUE(!grid.exists_in_box(0.0f, 100.0f, 70.0f, 100.0f, CellOrder::CenterOut));
+    ASSERT_TRUE(grid.exists_in_box(0.0f, 100.0f, 59.0f, 60.0f));
+    ASSERT_TRUE(!grid.exists_in_box(0.0f, 100.0f, 60.0f, 70.0f, CellOrder::RowMajor, false, true));
+
+    // Row-major limit/offset pages through query_box() order
+    std::vector<size_t> page, paged;
+    for (size_t offset = 0;; offset += 64) {
+        size_t n = grid.query_box_limit(5.0f, 95.0f, 5.0f, 95.0f, page, 64, offset);
+        ASSERT_EQ(n, page.size());
+        ASSERT_TRUE(n <= 64);
+        paged.insert(paged.end(), page.begin(), page.end());
+        if (n < 64) break;
+    }
+    ASSERT_TRUE(paged == all);
+    ASSERT_EQ(grid.query_box_limit(5.0f, 95.0f, 5.0f, 95.0f, page, 0), 0);
+
+    // Centre-out visits every cell exactly once, starting at the middle cell
+    std::vector<size_t> centre_out;
+    grid.query_box_limit(5.0f, 95.0f, 5.0f, 95.0f, centre_out, all.size() + 1, 0,
+                         CellOrder::CenterOut);
+    std::vector<size_t> middle = grid.query_box(45.0f, 45.0f, 45.0f, 45.0f);
+    ASSERT_TRUE(!middle.empty());
+    ASSERT_TRUE(std::equal(middle.begin(), middle.end(), centre_out.begin()));
+    std::vector<size_t> sorted_all = all;
+    std::sort(sorted_all.begin(), sorted_all.end());
+    std::sort(centre_out.begin(), centre_out.end());
+    ASSERT_TRUE(centre_out == sorted_all);
+
+    // Same for an asymmetric range clipped by the grid
+    std::vector<size_t> clipped;
+    grid.query_box_limit(-50.0f, 35.0f, 12.0f, 99.0f, clipped, 100000, 0, CellOrder::CenterOut);
+    std::vector<size_t> expected = grid.query_box(-50.0f, 35.0f, 12.0f, 99.0f);
+    std::sort(clipped.begin(), clipped.end());
+    std::sort(expected.begin(), expected.end());
+    ASSERT_TRUE(clipped == expected);
+}
+
+// Test multi-box union queries visit each cell once
+TEST(test_query_boxes_union) {
+    GridIndex2D<double> grid(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    for (int k = 0; k < 1000; ++k) {
+        grid.insert((k * 37) % 100 + 0.5, (k * 53) % 100 + 0.5, k);
+    }
+
+    std::vector<GridBox<double>> boxes;
+    GridBox<double> a = {10.0, 45.0, 10.0, 45.0};
+    GridBox<double> b = {30.0, 75.0, 35.0, 60.0};   // Overlaps a
+    GridBox<double> c = {95.0, 80.0, 5.0, 15.0};    // Reversed x extent
+    GridBox<double> d = {42.0, 43.0, 20.0, 21.0};   // Inside a
+    boxes.push_back(a);
+    boxes.push_back(b);
+    boxes.push_back(c);
+    boxes.push_back(d);
+
+    std::vector<size_t> result = grid.query_boxes_union(boxes);
+    std::vector<size_t> expected;
+    for (size_t k = 0; k < boxes.size(); ++k) {
+        std::vector<size_t> r = grid.query_box(boxes[k].x1, boxes[k].x2, boxes[k].y1, boxes[k].y2);
+        expected.insert(expected.end(), r.begin(), r.end());
+    }
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+    std::vector<size_t> sorted = result;
+    std::sort(sorted.begin(), sorted.end());
+    ASSERT_TRUE(sorted == expected);  // Same set, and no duplicates
+
+    // A single box gives exactly query_box(), including order and edge flags
+    std::vector<GridBox<double>> single(1, b);
+    ASSERT_TRUE(grid.query_boxes_union(single) == grid.query_box(b.x1, b.x2, b.y1, b.y2));
+    ASSERT_TRUE(grid.query_boxes_union(single, false, false) ==
+                grid.query_box(b.x1, b.x2, b.y1, b.y2, false, false));
+
+    // Appending and empty input
+    std::vector<size_t> appended(1, 12345);
+    grid.query_boxes_union(single, appended, true);
+    ASSERT_EQ(appended.size(), 1 + grid.query_box(b.x1, b.x2, b.y1, b.y2).size());
+    ASSERT_TRUE(grid.query_boxes_union(std::vector<GridBox<double>>()).empty());
+}
+
+// Test sorted-output queries by merging and by fallback sort
+TEST(test_query_box_sorted) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f);
+    // Interleaved numbering (cells overlap in index range) ...
+    for (int k = 0; k < 2000; ++k) {
+        grid.insert(static_cast<float>((k * 37) % 100), static_cast<float>((k * 53) % 100), k);
+    }
+    // ... followed by a block of spatially coherent numbering
+    for (int k = 2000; k < 2400; ++k) {
+        grid.insert(static_cast<float>((k - 2000) / 4), 50.0f, k);
+    }
+    ASSERT_TRUE(grid.cells_sorted());
+
+    const float boxes[][4] = {{10, 30, 20, 40}, {0, 100, 0, 100}, {45, 45, 45, 45}, {0, 100, 50, 55}};
+    for (const auto& b : boxes) {
+        std::vector<size_t> expected = grid.query_box(b[0], b[1], b[2], b[3]);
+        std::sort(expected.begin(), expected.end());
+        ASSERT_TRUE(grid.query_box_sorted(b[0], b[1], b[2], b[3]) == expected);
+    }
+    std::vector<size_t> result(3, 7);
+    grid.query_box_sorted(10.0f, 20.0f, 10.0f, 20.0f, result, false, false);
+    std::vector<size_t> expected = grid.query_box(10.0f, 20.0f, 10.0f, 20.0f, false, false);
+    std::sort(expected.begin(), expected.end());
+    ASSERT_TRUE(result == expected);
+
+    // Out-of-order inserts fall back to sorting until sort_cells()
+    grid.insert(5.0f, 5.0f, 1);
+    ASSERT_TRUE(!grid.cells_sorted());
+    expected = grid.query_box(0.0f, 30.0f, 0.0f, 30.0f);
+    std::sort(expected.begin(), expected.end());
+    ASSERT_TRUE(grid.query_box_sorted(0.0f, 30.0f, 0.0f, 30.0f) == expected);
+    grid.sort_cells();
+    ASSERT_TRUE(grid.cells_sorted());
+    ASSERT_TRUE(grid.query_box_sorted(0.0f, 30.0f, 0.0f, 30.0f) == expected);
+
+    // Bulk inserts track order too
+    grid.clear();
+    ASSERT_TRUE(grid.cells_sorted());
+    std::vector<float> xs(10, 15.0f), ys(10, 15.0f);
+    grid.insert_points(xs.data(), ys.data(), xs.size(), 100);
+    ASSERT_TRUE(grid.cells_sorted());
+    grid.insert_points(xs.data(), ys.data(), xs.size(), 0);
+    ASSERT_TRUE(!grid.cells_sorted());
+}
+
+template<typename T>
+static std::vector<size_t> brute_force_nearest(const GridIndex2D<T>& grid, const std::vector<T>& xs,
+                                               const std::vector<T>& ys, T x1, T x2, T y1, T y2,
+                                               T cx, T cy, size_t k) {
+    std::vector<size_t> ids = grid.query_box(x1, x2, y1, y2);
+    std::vector<std::pair<double, size_t>> d;
+    for (size_t idx : ids) {
+        if (xs[idx] < x1 || xs[idx] > x2 || ys[idx] < y1 || ys[idx] > y2) continue;
+        const double dx = static_cast<double>(xs[idx]) - static_cast<double>(cx);
+        const double dy = static_cast<double>(ys[idx]) - static_cast<double>(cy);
+        d.push_back(std::make_pair(dx * dx + dy * dy, idx));
+    }
+    std::sort(d.begin(), d.end());
+    std::vector<size_t> out;
+    for (size_t m = 0; m < d.size() && m < k; ++m) out.push_back(d[m].second);
+    return out;
+}
+
+TEST(test_query_box_nearest) {
+    GridIndex2D<double> grid(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    std::vector<double> xs, ys;
+    for (int k = 0; k < 3000; ++k) {
+        xs.push_back((k * 7919) % 10007 / 100.07);
+        ys.push_back((k * 104729) % 10009 / 100.09);
+    }
+    // Clamped into the edge cells, and a tie at the same position
+    xs.push_back(-50.0); ys.push_back(50.0);
+    xs.push_back(150.0); ys.push_back(150.0);
+    xs.push_back(xs[10]); ys.push_back(ys[10]);
+    grid.insert_points(xs.data(), ys.data(), xs.size());
+
+    const double queries[][6] = {
+        {20, 60, 30, 70, 41, 52}, {0, 100, 0, 100, 50, 50}, {0, 100, 0, 100, -20, 50},
+        {0, 100, 0, 100, 99, 99}, {35, 45, 35, 45, 0, 0}, {0, 100, 0, 100, xs[10], ys[10]}};
+    const size_t ks[] = {1, 5, 40, 500};
+    std::vector<size_t> result;
+    for (const auto& q : queries) {
+        for (size_t k : ks) {
+            const size_t n = grid.query_box_nearest(q[0], q[1], q[2], q[3], q[4], q[5],
+                                                    xs.data(), ys.data(), k, result);
+            ASSERT_EQ(n, result.size());
+            ASSERT_TRUE(result == brute_force_nearest(grid, xs, ys, q[0], q[1], q[2], q[3], q[4], q[5], k));
+        }
+    }
+    ASSERT_EQ(grid.query_box_nearest(0.0, 100.0, 0.0, 100.0, 50.0, 50.0, xs.data(), ys.data(), 0, result), 0u);
+
+    // Fewer candidates than k: all of them, nearest first
+    grid.query_box_nearest(0.0, 5.0, 0.0, 5.0, 0.0, 0.0, xs.data(), ys.data(), 100000, result);
+    size_t in_box = 0;
+    for (size_t idx : grid.query_box(0.0, 5.0, 0.0, 5.0)) {
+        if (xs[idx] >= 0.0 && xs[idx] <= 5.0 && ys[idx] >= 0.0 && ys[idx] <= 5.0) ++in_box;
+    }
+    ASSERT_TRUE(in_box > 0 && in_box < grid.query_box(0.0, 5.0, 0.0, 5.0).size());
+    ASSERT_EQ(result.size(), in_box);
+
+    // Integral coordinates, exclusive edges
+    GridIndex2D<int> igrid(1000, 2000, 25, 0, 500, 8);
+    std::vector<int> ix, iy;
+    for (int k = 0; k < 2000; ++k) {
+        ix.push_back(1000 + (k * 389) % 1000);
+        iy.push_back((k * 211) % 500);
+    }
+    igrid.insert_points(ix.data(), iy.data(), ix.size());
+    igrid.query_box_nearest(1100, 1400, 100, 300, 1250, 200, ix.data(), iy.data(), 25, result, false, false);
+    std::vector<size_t> ids = igrid.query_box(1100, 1400, 100, 300, false, false);
+    std::vector<std::pair<double, size_t>> d;
+    for (size_t idx : ids) {
+        if (ix[idx] <= 1100 || ix[idx] >= 1400 || iy[idx] <= 100 || iy[idx] >= 300) continue;
+        const double dx = ix[idx] - 1250.0, dy = iy[idx] - 200.0;
+        d.push_back(std::make_pair(dx * dx + dy * dy, idx));
+    }
+    std::sort(d.begin(), d.end());
+    ASSERT_EQ(result.size(), 25u);
+    for (size_t m = 0; m < result.size(); ++m) ASSERT_EQ(result[m], d[m].second);
+
+    // Boundary cell [2, 3) also holds a point beyond the box, nearer the centre
+    GridIndex2D<double> small(0.0, 10.0, 1.0, 0.0, 10.0, 1.0);
+    const double bx[] = {2.1, 2.9, 2.2}, by[] = {0.5, 0.5, 0.5};
+    small.insert_points(bx, by, 3);
+    ASSERT_EQ(small.query_box(2.0, 2.2, 0.0, 1.0).size(), 3u);
+    small.query_box_nearest(2.0, 2.2, 0.0, 1.0, 2.8, 0.5, bx, by, 1, result);
+    ASSERT_TRUE(result == std::vector<size_t>({2}));
+    small.query_box_nearest(2.0, 2.2, 0.0, 1.0, 2.8, 0.5, bx, by, 5, result);
+    ASSERT_TRUE(result == std::vector<size_t>({2, 0}));
+    // The upper edge excluded
+    small.query_box_nearest(2.0, 2.2, 0.0, 1.0, 2.8, 0.5, bx, by, 5, result, true, false);
+    ASSERT_TRUE(result == std::vector<size_t>({0}));
+}
+
+TEST(test_cell_access) {
+    GridIndex2D<float> grid(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f);
+    grid.insert(15.0f, 25.0f, 1);
+    grid.insert(35.0f, 25.0f, 2);
+    grid.insert(12.0f, 28.0f, 3);
+    ASSERT_TRUE(grid.get_cell(1, 2) == std::vector<size_t>({1, 3}));
+    ASSERT_TRUE(grid.get_cell(3, 2) == std::vector<size_t>({2}));
+    ASSERT_TRUE(grid.get_cell(0, 0).empty());
+
+    int i_min, i_max, j_min, j_max;
+    grid.get_box_cell_range(35.0f, 10.0f, 20.0f, 30.0f, i_min, i_max, j_min, j_max);
+    ASSERT_EQ(i_min, 1); ASSERT_EQ(i_max, 3);
+    ASSERT_EQ(j_min, 2); ASSERT_EQ(j_max, 3);
+    grid.get_box_cell_range(10.0f, 35.0f, 20.0f, 30.0f, i_min, i_max, j_min, j_max, true, false);
+    ASSERT_EQ(j_max, 2);
+    std::vector<size_t> collected;
+    for (int j = j_min; j <= j_max; ++j) {
+        for (int i = i_min; i <= i_max; ++i) {
+            const std::vector<size_t>& cell = grid.get_cell(i, j);
+            collected.insert(collected.end(), cell.begin(), cell.end());
+        }
+    }
+    ASSERT_TRUE(collected == grid.query_box(10.0f, 35.0f, 20.0f, 30.0f, true, false));
+}
+
+struct TracePayload {
+    float offset;
+    int header;
+};
+
+TEST(test_payloads) {
+    GridIndex2D<double, TracePayload> grid(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    std::vector<double> xs, ys;
+    std::vector<TracePayload> payloads;
+    for (int k = 0; k < 500; ++k) {
+        xs.push_back((k * 37) % 100 + 0.5);
+        ys.push_back((k * 53) % 100 + 0.5);
+        TracePayload p = {static_cast<float>(k * 10), 1000 + k};
+        payloads.push_back(p);
+    }
+    grid.insert_points(xs.data(), ys.data(), payloads.data(), 300);
+    for (size_t k = 300; k < 500; ++k) {
+        grid.insert(xs[k], ys[k], k, payloads[k]);
+    }
+    ASSERT_EQ(grid.get_num_points(), 500u);
+    // A grid with a Payload needs one per point
+    ASSERT_THROW(grid.insert_points(xs.data(), ys.data(), nullptr, 10), std::invalid_argument);
+    ASSERT_EQ(grid.get_num_points(), 500u);
+
+    // Same indices and order as the callback query; payloads match their points
+    std::vector<size_t> visited, expected;
+    grid.query_box_payload(12.0, 47.0, 5.0, 66.0, [&](size_t idx, const TracePayload& p) {
+        ASSERT_EQ(p.header, 1000 + static_cast<int>(idx));
+        visited.push_back(idx);
+    });
+    grid.query_box_callback(12.0, 47.0, 5.0, 66.0, [&](size_t idx) { expected.push_back(idx); });
+    ASSERT_TRUE(visited == expected);
+    ASSERT_TRUE(!visited.empty());
+
+    // Filtering on the payload; early stop
+    size_t in_range = 0;
+    grid.query_box_payload(0.0, 100.0, 0.0, 100.0, [&](size_t, const TracePayload& p) {
+        if (p.offset >= 1000.0f && p.offset < 2000.0f) ++in_range;
+    });
+    ASSERT_EQ(in_range, 100u);
+    size_t calls = 0;
+    grid.query_box_payload(0.0, 100.0, 0.0, 100.0, [&](size_t, const TracePayload&) {
+        return ++calls == 3 ? Visit::Stop : Visit::Continue;
+    });
+    ASSERT_EQ(calls, 3u);
+    visited.clear();
+    grid.query_box_payload(10.0, 20.0, 10.0, 20.0, [&](size_t idx, const TracePayload&) {
+        visited.push_back(idx);
+    }, true, false);
+    ASSERT_TRUE(visited == grid.query_box(10.0, 20.0, 10.0, 20.0, true, false));
+
+    // Payloads follow their indices through sort_cells() and shrink_to_fit()
+    GridIndex2D<double, TracePayload> shuffled(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    for (int k = 499; k >= 0; --k) {
+        shuffled.insert(xs[k], ys[k], k, payloads[k]);
+    }
+    ASSERT_TRUE(!shuffled.cells_sorted());
+    shuffled.sort_cells();
+    shuffled.shrink_to_fit();
+    for (int j = 0; j < 10; ++j) {
+        for (int i = 0; i < 10; ++i) {
+            const std::vector<size_t>& cell = shuffled.get_cell(i, j);
+            const std::vector<TracePayload>& cell_payloads = shuffled.get_cell_payloads(i, j);
+            ASSERT_EQ(cell.size(), cell_payloads.size());
+            for (size_t k = 0; k < cell.size(); ++k) {
+                if (k > 0) ASSERT_TRUE(cell[k - 1] < cell[k]);
+                ASSERT_EQ(cell_payloads[k].header, 1000 + static_cast<int>(cell[k]));
+            }
+        }
+    }
+
+    GridMemoryUsage usage = shuffled.memory_usage();
+    ASSERT_EQ(usage.payloads_used,
+              100 * sizeof(std::vector<TracePayload>) + 500 * sizeof(TracePayload));
+    ASSERT_EQ(usage.payloads_reserved, usage.payloads_used);
+    ASSERT_EQ(GridIndex2D<double>(0.0, 1.0, 1.0, 0.0, 1.0, 1.0).memory_usage().payloads_used, 0u);
+    shuffled.clear();
+    ASSERT_TRUE(shuffled.get_cell_payloads(0, 0).empty());
+    ASSERT_EQ(shuffled.memory_usage().payloads_used, 100 * sizeof(std::vector<TracePayload>));
+}
+
+TEST(test_query_box_where) {
+    GridIndex2D<double, TracePayload> grid(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    std::vector<double> xs, ys;
+    std::vector<TracePayload> payloads;
+    for (int k = 0; k < 2000; ++k) {
+        xs.push_back((k * 37) % 100 + 0.5);
+        ys.push_back((k * 53 + k / 100) % 100 + 0.5);
+        // Offsets follow x (whole cells in or out of a range) with a little noise
+        TracePayload p = {static_cast<float>(xs.back() * 10 + k % 7), k};
+        payloads.push_back(p);
+    }
+    grid.insert_points(xs.data(), ys.data(), payloads.data(), xs.size());
+    const GridAttributeSummary<float> summary = grid.summarize(&TracePayload::offset);
+    ASSERT_EQ(summary.get_num_cells(), grid.get_num_cells());
+
+    const double boxes[][4] = {{0.0, 100.0, 0.0, 100.0}, {12.0, 47.0, 5.0, 66.0},
+                               {55.0, 55.0, 20.0, 20.0}};
+    const float ranges[][2] = {{200.0f, 450.0f}, {0.0f, 5000.0f}, {303.0f, 303.5f},
+                               {900.0f, 100.0f}, {-5.0f, -1.0f}};
+    std::vector<size_t> result, with_summary, expected;
+    for (const auto& b : boxes) {
+        for (const auto& r : ranges) {
+            expected.clear();
+            grid.query_box_payload(b[0], b[1], b[2], b[3], [&](size_t idx, const TracePayload& p) {
+                if (grid_in_range(p.offset, r[0], r[1])) expected.push_back(idx);
+            });
+            ASSERT_EQ(grid.query_box_where(b[0], b[1], b[2], b[3], &TracePayload::offset,
+                                           r[0], r[1], result), expected.size());
+            ASSERT_TRUE(result == expected);
+            grid.query_box_where(b[0], b[1], b[2], b[3], &TracePayload::offset, r[0], r[1],
+                                 with_summary, &summary);
+            ASSERT_TRUE(with_summary == expected);
+        }
+    }
+
+    // Wrapped range: [900, inf) and (-inf, 100]
+    grid.query_box_where(0.0, 100.0, 0.0, 100.0, &TracePayload::offset, 900.0f, 100.0f, result);
+    for (size_t idx : result) {
+        ASSERT_TRUE(payloads[idx].offset >= 900.0f || payloads[idx].offset <= 100.0f);
+    }
+    ASSERT_TRUE(!result.empty());
+
+    // Lambda getter, open edges
+    grid.query_box_where(10.0, 30.0, 10.0, 30.0, [](const TracePayload& p) { return p.header % 2; },
+                         1, 1, result, nullptr, true, false);
+    expected.clear();
+    for (size_t idx : grid.query_box(10.0, 30.0, 10.0, 30.0, true, false)) {
+        if (idx % 2 == 1) expected.push_back(idx);
+    }
+    ASSERT_TRUE(result == expected);
+
+    // The summary goes stale on insert
+    grid.insert(5.0, 5.0, 5000, payloads[0]);
+    ASSERT_THROW(grid.query_box_where(0.0, 10.0, 0.0, 10.0, &TracePayload::offset, 0.0f, 1.0f,
+                                      result, &summary), std::invalid_argument);
+    const GridAttributeSummary<float> rebuilt = grid.summarize(&TracePayload::offset);
+    grid.query_box_where(0.0, 10.0, 0.0, 10.0, &TracePayload::offset, 0.0f, 10.0f, result, &rebuilt);
+    ASSERT_TRUE(std::find(result.begin(), result.end(), 5000u) != result.end());
+}
+
+TEST(test_query_box_key_range) {
+    GridIndex2D<double, TracePayload> grid(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    std::vector<double> xs, ys;
+    std::vector<TracePayload> payloads;
+    for (int k = 0; k < 2000; ++k) {
+        xs.push_back((k * 37) % 100 + 0.5);
+        ys.push_back((k * 53 + k / 100) % 100 + 0.5);
+        TracePayload p = {static_cast<float>((k * 7919) % 4000), k};
+        payloads.push_back(p);
+    }
+    grid.insert_points(xs.data(), ys.data(), payloads.data(), xs.size());
+    std::vector<size_t> result, expected;
+    ASSERT_TRUE(!grid.cells_key_sorted());
+    ASSERT_THROW(grid.query_box_key_range(0.0, 100.0, 0.0, 100.0, &TracePayload::offset,
+                                          0.0f, 1.0f, result), std::invalid_argument);
+
+    grid.sort_cells_by_key(&TracePayload::offset);
+    ASSERT_TRUE(grid.cells_key_sorted());
+    ASSERT_TRUE(!grid.cells_sorted());
+    ASSERT_EQ(grid.get_num_points(), 2000u);
+    for (size_t c = 0; c < grid.get_num_cells(); ++c) {
+        const auto& cell = grid.get_cell(static_cast<int>(c % 10), static_cast<int>(c / 10));
+        const auto& p = grid.get_cell_payloads(static_cast<int>(c % 10), static_cast<int>(c / 10));
+        for (size_t k = 0; k < cell.size(); ++k) {
+            ASSERT_EQ(p[k].header, static_cast<int>(cell[k]));
+            if (k > 0) ASSERT_TRUE(p[k - 1].offset <= p[k].offset);
+        }
+    }
+
+    const double boxes[][4] = {{0.0, 100.0, 0.0, 100.0}, {12.0, 47.0, 5.0, 66.0},
+                               {55.0, 55.0, 20.0, 20.0}};
+    const float ranges[][2] = {{1000.0f, 2000.0f}, {0.0f, 5000.0f}, {1523.0f, 1523.0f},
+                               {3500.0f, 400.0f}, {-5.0f, -1.0f}, {4001.0f, 5000.0f}};
+    for (const auto& b : boxes) {
+        for (const auto& r : ranges) {
+            grid.query_box_where(b[0], b[1], b[2], b[3], &TracePayload::offset, r[0], r[1], expected);
+            ASSERT_EQ(grid.query_box_key_range(b[0], b[1], b[2], b[3], &TracePayload::offset,
+                                               r[0], r[1], result), expected.size());
+            std::sort(result.begin(), result.end());
+            std::sort(expected.begin(), expected.end());
+            ASSERT_TRUE(result == expected);
+        }
+    }
+
+    // Lambda key, open edges; each cell's run comes out in key order
+    const auto offset = [](const TracePayload& p) { return p.offset; };
+    grid.query_box_key_range(10.0, 20.0, 10.0, 20.0, offset, 500.0f, 3000.0f, result, true, false);
+    for (size_t k = 1; k < result.size(); ++k) {
+        ASSERT_TRUE(payloads[result[k - 1]].offset <= payloads[result[k]].offset);
+    }
+    ASSERT_TRUE(!result.empty());
+
+    // Back to index order, or a new insert, requires sorting again
+    grid.sort_cells();
+    ASSERT_TRUE(grid.cells_sorted());
+    ASSERT_TRUE(!grid.cells_key_sorted());
+    grid.sort_cells_by_key(offset);
+    grid.insert(5.0, 5.0, 5000, payloads[0]);
+    ASSERT_THROW(grid.query_box_key_range(0.0, 10.0, 0.0, 10.0, offset, 0.0f, 1.0f, result),
+                 std::invalid_argument);
+}
+
+TEST(test_temporal_index) {
+    TemporalGridIndex2D<double, int> grid(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    ASSERT_THROW((TemporalGridIndex2D<double, int>(0.0, 100.0, 0.0, 0.0, 100.0, 10.0)),
+                 std::invalid_argument);
+    std::vector<size_t> result;
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 0, 100, result), 0u);
+
+    // The same 200 locations surveyed in epochs 0..9; epoch e holds indices e * 1000 + k
+    std::vector<double> xs, ys;
+    for (int k = 0; k < 200; ++k) {
+        xs.push_back((k * 37) % 100 + 0.5);
+        ys.push_back((k * 53) % 100 + 0.5);
+    }
+    for (int e = 0; e < 10; ++e) {
+        grid.append_epoch(xs.data(), ys.data(), e, xs.size(), e * 1000);
+    }
+    ASSERT_EQ(grid.get_num_points(), 2000u);
+    ASSERT_EQ(grid.latest_time(), 9);
+
+    GridIndex2D<double> epoch(0.0, 100.0, 10.0, 0.0, 100.0, 10.0);
+    epoch.insert_points(xs.data(), ys.data(), xs.size());
+    const std::vector<size_t> box = epoch.query_box(12.0, 47.0, 5.0, 66.0);
+    ASSERT_TRUE(!box.empty());
+
+    // [3, 5]: three epochs of every location in the box
+    grid.query_box(12.0, 47.0, 5.0, 66.0, 3, 5, result);
+    ASSERT_EQ(result.size(), 3 * box.size());
+    for (size_t idx : result) ASSERT_TRUE(idx >= 3000 && idx < 6000);
+    std::vector<size_t> expected;
+    for (int e = 3; e <= 5; ++e) {
+        for (size_t idx : box) expected.push_back(e * 1000 + idx);
+    }
+    std::sort(result.begin(), result.end());
+    std::sort(expected.begin(), expected.end());
+    ASSERT_TRUE(result == expected);
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 7, 7).size(), 200u);
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 5, 4).size(), 0u);
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 10, 20).size(), 0u);
+
+    // Appends must not go back in time; a rejected epoch inserts nothing
+    ASSERT_THROW(grid.append_epoch(xs.data(), ys.data(), 8, xs.size()), std::invalid_argument);
+    ASSERT_EQ(grid.get_num_points(), 2000u);
+
+    // Retention: keep epochs 6..9
+    size_t expired = grid.expire_before(6);
+    ASSERT_EQ(expired, 1200u);
+    expired = grid.expire_before(6);
+    ASSERT_EQ(expired, 0u);
+    ASSERT_EQ(grid.get_num_points(), 800u);
+    ASSERT_EQ(grid.earliest_time(), 6);
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 0, 5).size(), 0u);
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 0, 6).size(), 200u);
+    // Expire one epoch at a time: the start offsets advance without compacting
+    grid.append_epoch(xs.data(), ys.data(), 10, xs.size(), 10000);
+    expired = grid.expire_before(7);
+    ASSERT_EQ(expired, 200u);
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 0, 100).size(), 800u);
+    const GridMemoryUsage usage = grid.memory_usage();
+    ASSERT_EQ(usage.indices_used, 800 * sizeof(size_t));
+    ASSERT_TRUE(usage.payloads_used < usage.payloads_reserved);
+
+    // Unordered timestamps within an epoch, after the latest one
+    std::vector<int> times;
+    for (int k = 0; k < 200; ++k) times.push_back(20 - k % 3);
+    grid.append_epoch(xs.data(), ys.data(), times.data(), xs.size(), 20000);
+    grid.query_box(0.0, 100.0, 0.0, 100.0, 19, 19, result);
+    ASSERT_EQ(result.size(), 67u);
+    for (size_t idx : result) ASSERT_EQ((idx - 20000) % 3, 1u);
+    grid.query_box(0.0, 100.0, 0.0, 100.0, 8, 30, result);
+    ASSERT_EQ(result.size(), 800u);
+
+    expired = grid.expire_before(1000);
+    ASSERT_EQ(expired, 1000u);
+    ASSERT_EQ(grid.get_num_points(), 0u);
+    grid.append_epoch(xs.data(), ys.data(), 0, xs.size());
+    ASSERT_EQ(grid.get_num_points(), 200u);
+    grid.clear();
+    ASSERT_EQ(grid.query_box(0.0, 100.0, 0.0, 100.0, 0, 100).size(), 0u);
+}
+
 int main() {
     std::cout << "Running GridIndex2D Tests\n";
     std::cout << "=========================\n\n";
@@ -675,6 +1787,31 @@ int main() {
     RUN_TEST(test_edge_handling_non_boundary_points);
     RUN_TEST(test_edge_handling_multiple_cells);
     RUN_TEST(test_edge_handling_default_params);
+    RUN_TEST(test_seismic_datasets);
+    RUN_TEST(test_query_stats);
+    RUN_TEST(test_latency_histogram);
+    RUN_TEST(test_query_latency);
+    RUN_TEST(test_memory_usage);
+    RUN_TEST(test_occupancy);
+    RUN_TEST(test_shrink_to_fit);
+    RUN_TEST(test_reserve_cells);
+    RUN_TEST(test_clear_release_memory);
+    RUN_TEST(test_presized_construction);
+    RUN_TEST(test_insert_points);
+    RUN_TEST(test_cell_mapping_edges);
+    RUN_TEST(test_compute_cell_ids);
+    RUN_TEST(test_compile_time_edges);
+    RUN_TEST(test_integer_coordinates);
+    RUN_TEST(test_query_box_range);
+    RUN_TEST(test_early_termination);
+    RUN_TEST(test_query_boxes_union);
+    RUN_TEST(test_query_box_sorted);
+    RUN_TEST(test_query_box_nearest);
+    RUN_TEST(test_cell_access);
+    RUN_TEST(test_payloads);
+    RUN_TEST(test_query_box_where);
+    RUN_TEST(test_query_box_key_range);
+    RUN_TEST(test_temporal_index);
 
     std::cout << "\n=========================\n";
     std::cout << "All " << passed << " tests passed!\n";
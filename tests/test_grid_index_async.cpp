@@ -0,0 +1,160 @@
+/**
+ * @file test_grid_index_async.cpp
+ * @brief Unit tests for the coroutine query API (C++20)
+ *
+ * Simple test suite without external dependencies
+ */
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <stdexcept>
+#include "../include/grid_index_async.h"
+
+#define TEST(name) void name()
+#define ASSERT_EQ(a, b) assert((a) == (b))
+#define ASSERT_TRUE(cond) assert(cond)
+#define ASSERT_THROW(expr, exception) \
+    do { \
+        bool caught = false; \
+        try { expr; } \
+        catch (const exception&) { caught = true; } \
+        assert(caught); \
+    } while(0)
+
+#define RUN_TEST(name) \
+    do { \
+        std::cout << "Running " << #name << "... "; \
+        name(); \
+        std::cout << "PASSED\n"; \
+        passed++; \
+    } while(0)
+
+static GridIndex2D<double> make_grid() {
+    GridIndex2D<double> grid(0.0, 100.0, 5.0, 0.0, 100.0, 5.0);
+    for (int k = 0; k < 5000; ++k) {
+        grid.insert((k * 7919) % 10007 / 100.07, (k * 104729) % 10009 / 100.09, k);
+    }
+    return grid;
+}
+
+static std::vector<GridBox<double>> make_boxes() {
+    std::vector<GridBox<double>> boxes;
+    for (int k = 0; k < 200; ++k) {
+        const double x = (k * 37) % 100, y = (k * 61) % 100;
+        const double w = 1 + k % 30;
+        GridBox<double> b = {x, x + w, y, y + w / 2};
+        boxes.push_back(b);
+    }
+    GridBox<double> outside = {200.0, 300.0, 200.0, 300.0};
+    GridBox<double> swapped = {50.0, 20.0, 70.0, 10.0};
+    GridBox<double> edges = {10.0, 20.0, 10.0, 20.0};
+    // Zero width on a cell boundary: no cells with exclusive edges
+    GridBox<double> degenerate = {10.0, 10.0, 0.0, 25.0};
+    boxes.push_back(outside);
+    boxes.push_back(swapped);
+    boxes.push_back(edges);
+    boxes.push_back(degenerate);
+    return boxes;
+}
+
+// Cache prefetch that rejects ranges no query can read
+static void checked_prefetch(const void* addr, size_t bytes) {
+    ASSERT_TRUE(bytes < (size_t(1) << 30));
+    grid_prefetch_cache(addr, bytes);
+}
+
+static void throwing_prefetch(const void*, size_t) {
+    throw std::runtime_error("tile unavailable");
+}
+
+// A single task run to completion matches query_box_no_alloc()
+TEST(test_async_query_box) {
+    const GridIndex2D<double> grid = make_grid();
+    std::vector<size_t> result, expected;
+    for (const GridBox<double>& b : make_boxes()) {
+        GridQueryTask task = async_query_box(grid, b.x1, b.x2, b.y1, b.y2, result);
+        ASSERT_TRUE(!task.done());
+        task.run();
+        ASSERT_TRUE(task.done());
+        grid.query_box_no_alloc(b.x1, b.x2, b.y1, b.y2, expected);
+        ASSERT_TRUE(result == expected);
+
+        task = async_query_box(grid, b.x1, b.x2, b.y1, b.y2, result, grid_prefetch_willneed,
+                               false, true);
+        task.run();
+        grid.query_box_no_alloc(b.x1, b.x2, b.y1, b.y2, expected, false, false, true);
+        ASSERT_TRUE(result == expected);
+
+        task = async_query_box(grid, b.x1, b.x2, b.y1, b.y2, result, checked_prefetch,
+                               false, false);
+        task.run();
+        grid.query_box_no_alloc(b.x1, b.x2, b.y1, b.y2, expected, false, false, false);
+        ASSERT_TRUE(result == expected);
+    }
+}
+
+// Interleaved batches give every box its own query_box_no_alloc() result
+TEST(test_query_boxes_interleaved) {
+    const GridIndex2D<double> grid = make_grid();
+    const std::vector<GridBox<double>> boxes = make_boxes();
+    std::vector<size_t> expected;
+    const size_t widths[] = {1, 3, 8, 1000};
+    for (size_t width : widths) {
+        std::vector<std::vector<size_t>> results;
+        query_boxes_interleaved(grid, boxes, results, width);
+        ASSERT_EQ(results.size(), boxes.size());
+        for (size_t b = 0; b < boxes.size(); ++b) {
+            grid.query_box_no_alloc(boxes[b].x1, boxes[b].x2, boxes[b].y1, boxes[b].y2, expected);
+            ASSERT_TRUE(results[b] == expected);
+        }
+    }
+
+    std::vector<std::vector<size_t>> results;
+    query_boxes_interleaved(grid, std::vector<GridBox<double>>(), results);
+    ASSERT_TRUE(results.empty());
+}
+
+// Spawned tasks run inside run(); exceptions reach the caller
+TEST(test_interleaved_executor) {
+    const GridIndex2D<double> grid = make_grid();
+    std::vector<size_t> a, b, c;
+    GridInterleavedExecutor executor(2);
+    ASSERT_EQ(executor.width(), 2u);
+    executor.spawn(async_query_box(grid, 0.0, 50.0, 0.0, 50.0, a));
+    executor.spawn(async_query_box(grid, 40.0, 60.0, 40.0, 60.0, b));
+    executor.spawn(async_query_box(grid, 90.0, 99.0, 0.0, 99.0, c));
+    executor.run();
+    ASSERT_TRUE(a == grid.query_box(0.0, 50.0, 0.0, 50.0));
+    ASSERT_TRUE(b == grid.query_box(40.0, 60.0, 40.0, 60.0));
+    ASSERT_TRUE(c == grid.query_box(90.0, 99.0, 0.0, 99.0));
+
+    executor.spawn(async_query_box(grid, 0.0, 50.0, 0.0, 50.0, a));
+    executor.spawn(async_query_box(grid, 0.0, 50.0, 0.0, 50.0, b, throwing_prefetch));
+    executor.spawn(async_query_box(grid, 0.0, 50.0, 0.0, 50.0, c));
+    ASSERT_THROW(executor.run(), std::runtime_error);
+    // The failed batch is dropped; the executor is reusable
+    executor.spawn(async_query_box(grid, 40.0, 60.0, 40.0, 60.0, a));
+    executor.run();
+    ASSERT_TRUE(a == grid.query_box(40.0, 60.0, 40.0, 60.0));
+
+    GridQueryTask task = async_query_box(grid, 0.0, 50.0, 0.0, 50.0, a, throwing_prefetch);
+    ASSERT_THROW(task.run(), std::runtime_error);
+    ASSERT_TRUE(task.done());
+}
+
+int main() {
+    std::cout << "Running GridIndex2D Async Tests\n";
+    std::cout << "===============================\n\n";
+
+    int passed = 0;
+
+    RUN_TEST(test_async_query_box);
+    RUN_TEST(test_query_boxes_interleaved);
+    RUN_TEST(test_interleaved_executor);
+
+    std::cout << "\n===============================\n";
+    std::cout << "All " << passed << " tests passed!\n";
+
+    return 0;
+}
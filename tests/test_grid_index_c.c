@@ -0,0 +1,180 @@
+/**
+ * @file test_grid_index_c.c
+ * @brief Unit tests for the C API (libgrid_index_c), written in C
+ *
+ * Simple test suite without external dependencies
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "../include/grid_index_c.h"
+
+#define TEST(name) static void name(void)
+#define ASSERT_EQ(a, b) assert((a) == (b))
+#define ASSERT_TRUE(cond) assert(cond)
+
+#define RUN_TEST(name) \
+    do { \
+        printf("Running %s... ", #name); \
+        name(); \
+        printf("PASSED\n"); \
+        passed++; \
+    } while (0)
+
+#define NUM_POINTS 400
+
+/* Points on a 20 x 20 lattice at cell centres 5, 15, ..., 195; point k is at
+ * column k % 20, row k / 20 */
+static void make_points(float* xs, float* ys, double* xd, double* yd) {
+    int k;
+    for (k = 0; k < NUM_POINTS; ++k) {
+        xs[k] = 5.0f + 10.0f * (float)(k % 20);
+        ys[k] = 5.0f + 10.0f * (float)(k / 20);
+        xd[k] = xs[k];
+        yd[k] = ys[k];
+    }
+}
+
+static int contains(const int64_t* v, size_t n, int64_t x) {
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        if (v[i] == x) return 1;
+    }
+    return 0;
+}
+
+TEST(test_create_and_errors) {
+    grid_index_f32* grid = NULL;
+    size_t count = 0;
+
+    ASSERT_EQ(grid_index_api_version(), GRID_INDEX_C_API_VERSION);
+    ASSERT_EQ(grid_index_f32_create(0.0f, 100.0f, 0.0f, 0.0f, 100.0f, 10.0f, &grid),
+              GRID_INDEX_ERROR_INVALID_ARGUMENT);
+    ASSERT_TRUE(grid == NULL);
+    ASSERT_TRUE(strlen(grid_index_last_error()) > 0);
+    ASSERT_EQ(grid_index_f32_create(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f, NULL),
+              GRID_INDEX_ERROR_INVALID_ARGUMENT);
+
+    ASSERT_EQ(grid_index_f32_create(0.0f, 100.0f, 10.0f, 0.0f, 100.0f, 10.0f, &grid), GRID_INDEX_OK);
+    ASSERT_TRUE(grid != NULL);
+    ASSERT_EQ(grid_index_f32_num_points(grid), 0u);
+    ASSERT_EQ(grid_index_f32_insert_points(grid, NULL, NULL, 5, 0), GRID_INDEX_ERROR_INVALID_ARGUMENT);
+    ASSERT_EQ(grid_index_f32_query_box(grid, 0, 1, 0, 1, 1, 1, NULL, 0, &count), GRID_INDEX_OK);
+    ASSERT_EQ(count, 0u);
+    ASSERT_EQ(grid_index_f32_query_box(NULL, 0, 1, 0, 1, 1, 1, NULL, 0, &count),
+              GRID_INDEX_ERROR_INVALID_ARGUMENT);
+    ASSERT_EQ(grid_index_f32_num_points(NULL), 0u);
+    grid_index_f32_free(grid);
+    grid_index_f32_free(NULL);
+}
+
+TEST(test_query_box) {
+    float xs[NUM_POINTS], ys[NUM_POINTS];
+    double xd[NUM_POINTS], yd[NUM_POINTS];
+    int64_t out[NUM_POINTS];
+    size_t count = 0;
+    grid_index_f32* g32 = NULL;
+    grid_index_f64* g64 = NULL;
+
+    make_points(xs, ys, xd, yd);
+    ASSERT_EQ(grid_index_f32_create(0.0f, 200.0f, 10.0f, 0.0f, 200.0f, 10.0f, &g32), GRID_INDEX_OK);
+    ASSERT_EQ(grid_index_f64_create(0.0, 200.0, 10.0, 0.0, 200.0, 10.0, &g64), GRID_INDEX_OK);
+    ASSERT_EQ(grid_index_f32_insert_points(g32, xs, ys, NUM_POINTS, 0), GRID_INDEX_OK);
+    ASSERT_EQ(grid_index_f64_insert_points(g64, xd, yd, NUM_POINTS, 1000), GRID_INDEX_OK);
+    ASSERT_EQ(grid_index_f32_num_points(g32), (size_t)NUM_POINTS);
+    ASSERT_EQ(grid_index_f64_num_points(g64), (size_t)NUM_POINTS);
+
+    /* Cells 1..3 x 2..3: columns 1-3 of rows 2-3 */
+    ASSERT_EQ(grid_index_f32_query_box(g32, 12.0f, 38.0f, 21.0f, 39.0f, 1, 1, out, NUM_POINTS, &count),
+              GRID_INDEX_OK);
+    ASSERT_EQ(count, 6u);
+    ASSERT_TRUE(contains(out, count, 41) && contains(out, count, 63));
+    ASSERT_EQ(grid_index_f64_query_box(g64, 12.0, 38.0, 21.0, 39.0, 1, 1, out, NUM_POINTS, &count),
+              GRID_INDEX_OK);
+    ASSERT_EQ(count, 6u);
+    ASSERT_TRUE(contains(out, count, 1041) && contains(out, count, 1063));
+
+    /* Open upper edges on cell boundaries drop the cells beyond them */
+    ASSERT_EQ(grid_index_f32_query_box(g32, 10.0f, 30.0f, 20.0f, 40.0f, 1, 0, out, NUM_POINTS, &count),
+              GRID_INDEX_OK);
+    ASSERT_EQ(count, 4u);
+
+    /* Too small: buffer filled, full count reported */
+    out[2] = -1;
+    ASSERT_EQ(grid_index_f32_query_box(g32, 0.0f, 200.0f, 0.0f, 200.0f, 1, 1, out, 2, &count),
+              GRID_INDEX_ERROR_BUFFER_TOO_SMALL);
+    ASSERT_EQ(count, (size_t)NUM_POINTS);
+    ASSERT_EQ(out[2], -1);
+    ASSERT_EQ(grid_index_f32_query_box(g32, 0.0f, 200.0f, 0.0f, 200.0f, 1, 1, NULL, 0, &count),
+              GRID_INDEX_ERROR_BUFFER_TOO_SMALL);
+    ASSERT_EQ(count, (size_t)NUM_POINTS);
+
+    ASSERT_EQ(grid_index_f64_clear(g64), GRID_INDEX_OK);
+    ASSERT_EQ(grid_index_f64_num_points(g64), 0u);
+    grid_index_f32_free(g32);
+    grid_index_f64_free(g64);
+}
+
+TEST(test_query_boxes_csr) {
+    float xs[NUM_POINTS], ys[NUM_POINTS];
+    double xd[NUM_POINTS], yd[NUM_POINTS];
+    const double boxes[4 * 4] = {
+        12.0, 38.0, 21.0, 39.0,   /* 6 points */
+        500.0, 600.0, 500.0, 600.0,  /* clamped to the corner cell: 1 point */
+        0.0, 200.0, 0.0, 9.0,     /* bottom row: 20 points */
+        55.0, 55.0, 55.0, 55.0    /* 1 point */
+    };
+    int64_t offsets[5];
+    int64_t indices[NUM_POINTS];
+    int64_t single[NUM_POINTS];
+    size_t total = 0, count = 0;
+    size_t b, k;
+    grid_index_f64* grid = NULL;
+
+    make_points(xs, ys, xd, yd);
+    ASSERT_EQ(grid_index_f64_create(0.0, 200.0, 10.0, 0.0, 200.0, 10.0, &grid), GRID_INDEX_OK);
+    ASSERT_EQ(grid_index_f64_insert_points(grid, xd, yd, NUM_POINTS, 0), GRID_INDEX_OK);
+
+    ASSERT_EQ(grid_index_f64_query_boxes(grid, boxes, 4, 1, 1, offsets, indices, NUM_POINTS, &total),
+              GRID_INDEX_OK);
+    ASSERT_EQ(total, 28u);
+    ASSERT_EQ(offsets[0], 0);
+    ASSERT_EQ(offsets[4], 28);
+    for (b = 0; b < 4; ++b) {
+        const double* q = boxes + 4 * b;
+        ASSERT_EQ(grid_index_f64_query_box(grid, q[0], q[1], q[2], q[3], 1, 1, single, NUM_POINTS, &count),
+                  GRID_INDEX_OK);
+        ASSERT_EQ((int64_t)count, offsets[b + 1] - offsets[b]);
+        for (k = 0; k < count; ++k) {
+            ASSERT_EQ(indices[offsets[b] + k], single[k]);
+        }
+    }
+    ASSERT_EQ(indices[offsets[1]], NUM_POINTS - 1);
+
+    /* Sizing pass: no index buffer, offsets still complete */
+    ASSERT_EQ(grid_index_f64_query_boxes(grid, boxes, 4, 1, 1, offsets, NULL, 0, &total),
+              GRID_INDEX_ERROR_BUFFER_TOO_SMALL);
+    ASSERT_EQ(total, 28u);
+    ASSERT_EQ(offsets[3], 27);
+
+    ASSERT_EQ(grid_index_f64_query_boxes(grid, NULL, 0, 1, 1, offsets, NULL, 0, &total), GRID_INDEX_OK);
+    ASSERT_EQ(total, 0u);
+    ASSERT_EQ(offsets[0], 0);
+    grid_index_f64_free(grid);
+}
+
+int main(void) {
+    int passed = 0;
+
+    printf("Running GridIndex C API Tests\n");
+    printf("=============================\n\n");
+
+    RUN_TEST(test_create_and_errors);
+    RUN_TEST(test_query_box);
+    RUN_TEST(test_query_boxes_csr);
+
+    printf("\n=============================\n");
+    printf("All %d tests passed!\n", passed);
+    return 0;
+}
@@ -0,0 +1,162 @@
+"""
+Unit tests for the Python module (grid_index)
+
+Simple test suite without external dependencies; the NumPy test runs only
+when NumPy is installed.
+"""
+
+import array
+import sys
+import threading
+
+import grid_index
+
+NUM_POINTS = 400
+
+
+def make_points(typecode):
+    """Points on a 20 x 20 lattice at cell centres 5, 15, ..., 195; point k is
+    at column k % 20, row k / 20"""
+    xs = array.array(typecode, (5.0 + 10.0 * (k % 20) for k in range(NUM_POINTS)))
+    ys = array.array(typecode, (5.0 + 10.0 * (k // 20) for k in range(NUM_POINTS)))
+    return xs, ys
+
+
+def make_grid(dtype="float64", typecode="d"):
+    grid = grid_index.GridIndex(0.0, 200.0, 10.0, 0.0, 200.0, 10.0, dtype=dtype)
+    grid.insert_points(*make_points(typecode))
+    return grid
+
+
+def assert_raises(exception, f, *args, **kwargs):
+    try:
+        f(*args, **kwargs)
+    except exception:
+        return
+    raise AssertionError("%s not raised" % exception.__name__)
+
+
+def test_create_and_errors():
+    grid = grid_index.GridIndex(0.0, 100.0, 10.0, 0.0, 100.0, 10.0)
+    assert grid.dtype == "float64"
+    assert grid.num_points == 0 and len(grid) == 0
+    assert_raises(ValueError, grid_index.GridIndex, 0.0, 100.0, 0.0, 0.0, 100.0, 10.0)
+    assert_raises(ValueError, grid_index.GridIndex, 0.0, 100.0, 10.0, 0.0, 100.0, 10.0,
+                  dtype="int32")
+
+    xs, ys = make_points("d")
+    assert_raises(ValueError, grid.insert_points, xs, ys[:10])
+    assert_raises(ValueError, grid.insert_points, xs, ys, -1)
+    # Coordinates are read in place, so the dtype must match
+    assert_raises(TypeError, grid.insert_points, *make_points("f"))
+    assert_raises(TypeError, grid.insert_points, [1.0], [2.0])
+    assert_raises(ValueError, grid.query_boxes, array.array("d", [0.0, 1.0, 2.0]))
+    assert len(grid) == 0
+
+
+def test_query_box():
+    for dtype, typecode in (("float32", "f"), ("float64", "d")):
+        grid = make_grid(dtype, typecode)
+        assert grid.dtype == dtype
+        assert grid.num_points == NUM_POINTS
+
+        # Cells 1..3 x 2..3: columns 1-3 of rows 2-3
+        result = grid.query_box(12.0, 38.0, 21.0, 39.0)
+        assert result.format == "q" and result.itemsize == 8
+        assert sorted(result.tolist()) == [41, 42, 43, 61, 62, 63]
+        # Open upper edges on cell boundaries drop the cells beyond them
+        assert len(grid.query_box(10.0, 30.0, 20.0, 40.0, include_max=False)) == 4
+        assert len(grid.query_box(500.0, 600.0, 500.0, 600.0)) == 1
+        # Large boxes run without the GIL; same result
+        assert sorted(grid.query_box(0.0, 200.0, 0.0, 200.0).tolist()) == list(range(NUM_POINTS))
+
+        grid.clear()
+        assert len(grid) == 0
+        assert len(grid.query_box(0.0, 200.0, 0.0, 200.0)) == 0
+
+    grid = grid_index.GridIndex(0.0, 200.0, 10.0, 0.0, 200.0, 10.0)
+    xs, ys = make_points("d")
+    grid.insert_points(xs, ys, first_index=1000)
+    assert sorted(grid.query_box(55.0, 55.0, 55.0, 55.0).tolist()) == [1105]
+
+
+def test_query_boxes_csr():
+    grid = make_grid()
+    boxes = array.array("d", [
+        12.0, 38.0, 21.0, 39.0,      # 6 points
+        500.0, 600.0, 500.0, 600.0,  # clamped to the corner cell: 1 point
+        0.0, 200.0, 0.0, 9.0,        # bottom row: 20 points
+        55.0, 55.0, 55.0, 55.0,      # 1 point
+    ])
+    offsets, indices = grid.query_boxes(boxes)
+    assert offsets.tolist() == [0, 6, 7, 27, 28]
+    assert len(indices) == 28
+    for b in range(4):
+        x1, x2, y1, y2 = boxes[4 * b:4 * b + 4]
+        assert indices[offsets[b]:offsets[b + 1]].tolist() == grid.query_box(x1, x2, y1, y2).tolist()
+
+    offsets, indices = grid.query_boxes(memoryview(boxes).cast("B").cast("d", (4, 4)),
+                                        include_max=False)
+    assert len(offsets) == 5
+
+    offsets, indices = grid.query_boxes(array.array("d"))
+    assert offsets.tolist() == [0] and len(indices) == 0
+
+
+def test_threads():
+    grid = make_grid()
+    boxes = array.array("d", [0.0, 200.0, 0.0, 200.0] * 50)
+    totals = []
+
+    def worker():
+        offsets, indices = grid.query_boxes(boxes)
+        totals.append(len(indices))
+
+    threads = [threading.Thread(target=worker) for _ in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert totals == [50 * NUM_POINTS] * 4
+
+
+def test_numpy():
+    try:
+        import numpy as np
+    except ImportError:
+        print("(NumPy not installed) ", end="")
+        return
+    rng = np.random.default_rng(1)
+    xs = rng.uniform(0, 200, 10000)
+    ys = rng.uniform(0, 200, 10000)
+    grid = grid_index.GridIndex(0.0, 200.0, 10.0, 0.0, 200.0, 10.0)
+    grid.insert_points(xs, ys)
+    boxes = np.array([[10.0, 50.0, 20.0, 90.0], [0.0, 200.0, 0.0, 200.0]])
+    offsets, indices = (np.asarray(a) for a in grid.query_boxes(boxes))
+    assert offsets.dtype == np.int64 and indices.dtype == np.int64
+    first = np.sort(indices[offsets[0]:offsets[1]])
+    inside = np.nonzero((xs >= 10) & (xs <= 50) & (ys >= 20) & (ys <= 90))[0]
+    assert np.all(np.isin(inside, first))
+    assert offsets[2] - offsets[1] == 10000
+    assert_raises(TypeError, grid.insert_points, xs.astype(np.float32), ys.astype(np.float32))
+    # Strided views are not contiguous and are rejected rather than copied
+    assert_raises(ValueError, grid.insert_points, xs[::2], ys[::2])
+
+
+def main():
+    print("Running GridIndex Python Tests")
+    print("==============================\n")
+    passed = 0
+    for test in (test_create_and_errors, test_query_box, test_query_boxes_csr, test_threads,
+                 test_numpy):
+        print("Running %s... " % test.__name__, end="")
+        sys.stdout.flush()
+        test()
+        print("PASSED")
+        passed += 1
+    print("\n==============================")
+    print("All %d tests passed!" % passed)
+
+
+if __name__ == "__main__":
+    main()